@@ -1,6 +1,7 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <array>
 #include <vector>
 #include <queue>
 #include <memory>
@@ -11,18 +12,46 @@
 #include <functional>
 #include <stdexcept>
 
+#include "tracer.hpp"
+
 class ThreadPool {
 public:
+    // idle workers take the most urgent queued task first
+    enum priority { high, normal, low, priorities };
+
     ThreadPool(size_t);
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args) 
         -> std::future<typename std::result_of<F(Args...)>::type>;
+    template<class F, class... Args>
+    auto enqueue_at(priority p, F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
+    // runs the task on the given worker, so its data stays on that core;
+    // at normal priority unless given one
+    template<class F, class... Args>
+    auto enqueue_to(size_t worker, F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
+    template<class F, class... Args>
+    auto enqueue_to_at(size_t worker, priority p, F&& f, Args&&... args)
+        -> std::future<typename std::result_of<F(Args...)>::type>;
     ~ThreadPool();
+private:
+    typedef std::queue< std::function<void()> > task_queue;
+    bool idle(const task_queue *own) const;
 public:
+    // how tasks from each queue show up in a trace
+    static const char *task_name(int p)
+    {
+        static const char *const names[priorities] = {"high task", "normal task", "low task"};
+        return names[p];
+    }
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
+    // the task queues, one per priority
+    task_queue tasks[priorities];
+    // tasks for one worker only, per priority; each goes before the
+    // shared tasks of the same priority
+    std::vector< std::array<task_queue, priorities> > worker_tasks;
     
     // synchronization
     std::mutex queue_mutex;
@@ -32,36 +61,67 @@ public:
  
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads)
-    :   stop(false)
+    :   worker_tasks(threads),
+        stop(false)
 {
     for(size_t i = 0;i<threads;++i)
         workers.emplace_back(
-            [this]
+            [this, i]
             {
+                const auto own = this->worker_tasks[i].data();
                 for(;;)
                 {
                     std::function<void()> task;
+                    const char *name = "pinned task";
 
                     {
                         std::unique_lock<std::mutex> lock(this->queue_mutex);
                         this->condition.wait(lock,
-                            [this]{ return this->stop || !this->tasks.empty(); });
-                        if(this->stop && this->tasks.empty())
+                            [this, &own]{ return this->stop || !this->idle(own); });
+                        if(this->stop && this->idle(own))
                             return;
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
+                        task_queue *queue = nullptr;
+                        for(int p = high; !queue; ++p) {
+                            if(!own[p].empty()) {
+                                queue = &own[p];
+                            }
+                            else if(!this->tasks[p].empty()) {
+                                queue = &this->tasks[p];
+                                name = task_name(p);
+                            }
+                        }
+                        task = std::move(queue->front());
+                        queue->pop();
                     }
 
+                    if(tracer *t = tracer::active.load(std::memory_order_relaxed))
+                        t->label_thread("worker", (int)i);
+                    trace_scope scope(name, "pool");
                     task();
                 }
             }
         );
 }
 
+inline bool ThreadPool::idle(const task_queue *own) const
+{
+    for(int p = high; p < priorities; ++p)
+        if(!own[p].empty() || !tasks[p].empty())
+            return false;
+    return true;
+}
+
 // add new work item to the pool
 template<class F, class... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args) 
     -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    return enqueue_at(normal, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::enqueue_at(priority p, F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
 {
     using return_type = typename std::result_of<F(Args...)>::type;
 
@@ -77,12 +137,43 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
         if(stop)
             throw std::runtime_error("enqueue on stopped ThreadPool");
 
-        tasks.emplace([task](){ (*task)(); });
+        tasks[p].emplace([task](){ (*task)(); });
     }
     condition.notify_one();
     return res;
 }
 
+template<class F, class... Args>
+auto ThreadPool::enqueue_to(size_t worker, F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    return enqueue_to_at(worker, normal, std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<class F, class... Args>
+auto ThreadPool::enqueue_to_at(size_t worker, priority p, F&& f, Args&&... args)
+    -> std::future<typename std::result_of<F(Args...)>::type>
+{
+    using return_type = typename std::result_of<F(Args...)>::type;
+
+    auto task = std::make_shared< std::packaged_task<return_type()> >(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
+        );
+
+    std::future<return_type> res = task->get_future();
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+
+        if(stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        worker_tasks[worker % worker_tasks.size()][p].emplace([task](){ (*task)(); });
+    }
+    // the one woken by notify_one might not be the right worker
+    condition.notify_all();
+    return res;
+}
+
 // the destructor joins all threads
 inline ThreadPool::~ThreadPool()
 {
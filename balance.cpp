@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include "balance.hpp"
+
+namespace {
+  // weight of the newest timing against the history
+  const double smoothing = 0.5;
+}
+
+balancer::balancer(const int &units, const int &parts)
+  : adaptive(true)
+{
+  reset(units, parts);
+}
+
+void balancer::reset(const int &units, const int &parts) {
+  cost.assign(units, 0);
+  bounds.resize(std::max(parts, 1) + 1);
+  for(int p = 0; p <= this->parts(); p++) {
+    bounds[p] = (int)((long long)units*p/this->parts());
+  }
+  seconds.assign(this->parts(), -1);
+  timed.assign(this->parts(), ranges());
+}
+
+double balancer::average_cost() const {
+  double known = 0;
+  int timed_units = 0;
+  for(auto c : cost) {
+    if(c > 0) {
+      known += c;
+      timed_units++;
+    }
+  }
+  return timed_units ? known/timed_units : 1;
+}
+
+void balancer::split(const ranges &pieces, std::vector<ranges> &split) const {
+  split.assign(parts(), ranges());
+  const double average = average_cost();
+  auto unit_cost = [this, average] (const int &u) { return adaptive && cost[u] > 0 ? cost[u] : average; };
+
+  double total = 0;
+  for(auto const &r : pieces) {
+    for(int u = r.first; u < r.second; u++) total += unit_cost(u);
+  }
+  // unit u goes to the part its running cost midpoint falls in
+  double sum = 0;
+  int p = 0;
+  for(auto const &r : pieces) {
+    for(int u = r.first; u < r.second; u++) {
+      const double c = unit_cost(u);
+      while(p < parts()-1 && sum + c/2 >= total*(p+1)/parts()) p++;
+      sum += c;
+      auto &own = split[p];
+      if(!own.empty() && own.back().second == u) own.back().second = u+1;
+      else own.emplace_back(u, u+1);
+    }
+  }
+}
+
+void balancer::measured(const int &part, const double &seconds) {
+  this->seconds[part] = seconds;
+  timed[part].assign(1, std::make_pair(from(part), to(part)));
+}
+
+void balancer::measured(const int &part, const double &seconds, const ranges &units) {
+  this->seconds[part] = seconds;
+  timed[part] = units;
+}
+
+void balancer::rebalance() {
+  if(!adaptive) return;
+  for(int p = 0; p < parts(); p++) {
+    int n = 0;
+    for(auto const &r : timed[p]) n += r.second - r.first;
+    if(seconds[p] < 0 || n == 0) continue;
+    const double per_unit = seconds[p]/n;
+    for(auto const &r : timed[p]) {
+      for(int u = r.first; u < r.second; u++) {
+        cost[u] = cost[u] > 0 ? (1-smoothing)*cost[u] + smoothing*per_unit : per_unit;
+      }
+    }
+    seconds[p] = -1;
+  }
+
+  // units only cropped steps have left out cost the average
+  const double average = average_cost();
+  auto unit_cost = [this, average] (const int &u) { return cost[u] > 0 ? cost[u] : average; };
+  double total = 0;
+  for(int u = 0; u < (int)cost.size(); u++) total += unit_cost(u);
+  if(total <= 0) return;
+
+  // bound p goes where the running cost passes p/parts of the total
+  const int units = (int)cost.size();
+  double sum = 0;
+  int u = 0;
+  for(int p = 1; p < parts(); p++) {
+    const double share = total*p/parts();
+    while(u < units && sum + unit_cost(u)/2 < share) sum += unit_cost(u++);
+    bounds[p] = u;
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef BALANCE_HPP
+#define BALANCE_HPP
+
+#include <utility>
+#include <vector>
+
+// Splits units 0..n (columns or rows) into contiguous parts of
+// about equal cost. The cost of each unit is learned from how long the
+// parts took to step, smoothed over generations, so regions that are
+// slower to step end up in smaller parts. Steps over only some of the
+// units are split by split() and timed per part over what it stepped.
+class balancer
+{
+public:
+  typedef std::vector< std::pair<int,int> > ranges;
+
+private:
+  // smoothed seconds per unit
+  std::vector<double> cost;
+  // part p covers units bounds[p] to bounds[p+1]
+  std::vector<int> bounds;
+  std::vector<double> seconds;
+  // the units each part was timed over
+  std::vector<ranges> timed;
+
+  // of the units timed so far, 1 before any
+  double average_cost() const;
+
+public:
+  // with adaptive off the parts stay even
+  bool adaptive;
+
+public:
+  balancer(const int &units = 0, const int &parts = 1);
+
+  void reset(const int &units, const int &parts);
+  int parts() const { return (int)bounds.size() - 1; }
+  int from(const int &part) const { return bounds[part]; }
+  int to(const int &part) const { return bounds[part+1]; }
+  // Splits the units of pieces, ascending [from, to) ranges, into
+  // contiguous runs of about equal cost per part. Units that were never
+  // timed count as the average.
+  void split(const ranges &pieces, std::vector<ranges> &split) const;
+  // each part reports its own time, so parts may report concurrently;
+  // without units the part stepped its bounds
+  void measured(const int &part, const double &seconds);
+  void measured(const int &part, const double &seconds, const ranges &units);
+  // folds the reported times into the costs and moves the bounds
+  void rebalance();
+};
+
+#endif // BALANCE_HPP
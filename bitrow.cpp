@@ -0,0 +1,39 @@
+#include "bitrow.hpp"
+
+void bitrow::life_row(const uint64_t *above, const uint64_t *row, const uint64_t *below,
+                      uint64_t *out, const int &words, const int &width,
+                      const rule_counts &r, uint64_t *scratch) {
+  uint64_t *aw = scratch, *ae = scratch+words;
+  uint64_t *rw = scratch+2*words, *re = scratch+3*words;
+  uint64_t *bw = scratch+4*words, *be = scratch+5*words;
+  shift_west(above, aw, words, width);
+  shift_east(above, ae, words, width);
+  shift_west(row, rw, words, width);
+  shift_east(row, re, words, width);
+  shift_west(below, bw, words, width);
+  shift_east(below, be, words, width);
+
+  for(int i = 0; i < words; i++) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    add_bit(s0, s1, s2, s3, aw[i]);
+    add_bit(s0, s1, s2, s3, above[i]);
+    add_bit(s0, s1, s2, s3, ae[i]);
+    add_bit(s0, s1, s2, s3, rw[i]);
+    add_bit(s0, s1, s2, s3, re[i]);
+    add_bit(s0, s1, s2, s3, bw[i]);
+    add_bit(s0, s1, s2, s3, below[i]);
+    add_bit(s0, s1, s2, s3, be[i]);
+
+    const uint64_t alive = row[i];
+    if(r.conway) {
+      // 3 neighbours, or 2 and already alive
+      out[i] = ~s3 & ~s2 & s1 & (s0 | alive);
+      continue;
+    }
+    uint64_t born = 0, survives = 0;
+    for(int b = 0; b < r.births; b++) born |= count_is(r.birth[b], s0, s1, s2, s3);
+    for(int b = 0; b < r.survivals; b++) survives |= count_is(r.survive[b], s0, s1, s2, s3);
+    out[i] = (~alive & born) | (alive & survives);
+  }
+  out[words-1] &= tail_mask(width);
+}
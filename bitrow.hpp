@@ -0,0 +1,128 @@
+#ifndef BITROW_HPP
+#define BITROW_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+#include "rule.hpp"
+
+// Helpers for rows packed 64 cells per word, bit x%64 of word x/64 being
+// cell x. Bits past width in the last word are kept zero.
+namespace bitrow {
+  inline int words_for(const int &width) { return (width+63)/64; }
+
+  inline uint64_t tail_mask(const int &width) {
+    return width%64 ? (uint64_t(1) << (width%64)) - 1 : ~uint64_t(0);
+  }
+
+  // row shifted so that bit x holds the cell at x-1, wrapping at width
+  inline void shift_west(const uint64_t *in, uint64_t *out, const int &words, const int &width) {
+    for(int i = 0; i < words; i++) {
+      out[i] = (in[i] << 1) | (i > 0 ? in[i-1] >> 63 : 0);
+    }
+    const int last = width-1;
+    out[0] |= (in[last/64] >> (last%64)) & 1;
+    out[words-1] &= tail_mask(width);
+  }
+
+  // row shifted so that bit x holds the cell at x+1, wrapping at width
+  inline void shift_east(const uint64_t *in, uint64_t *out, const int &words, const int &width) {
+    for(int i = 0; i < words; i++) {
+      out[i] = (in[i] >> 1) | (i+1 < words ? in[i+1] << 63 : 0);
+    }
+    const int last = width-1;
+    out[last/64] |= (in[0] & 1) << (last%64);
+  }
+
+  // n <= 64 cells starting at x, cell x in bit 0
+  inline uint64_t get_bits(const uint64_t *row, const int &x, const int &n) {
+    const int w = x/64, b = x%64;
+    uint64_t v = row[w] >> b;
+    if(b && b+n > 64) v |= row[w+1] << (64-b);
+    return n == 64 ? v : v & ((uint64_t(1) << n) - 1);
+  }
+
+  inline void set_bits(uint64_t *row, const int &x, const int &n, const uint64_t &v) {
+    const int w = x/64, b = x%64;
+    const uint64_t mask = n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+    row[w] = (row[w] & ~(mask << b)) | ((v & mask) << b);
+    if(b && b+n > 64) {
+      row[w+1] = (row[w+1] & ~(mask >> (64-b))) | ((v & mask) >> (64-b));
+    }
+  }
+
+  inline uint64_t count_bits(const uint64_t *row, const int &x, const int &n) {
+    uint64_t live = 0;
+    for(int done = 0; done < n; done += 64) {
+      live += __builtin_popcountll(get_bits(row, x+done, std::min(64, n-done)));
+    }
+    return live;
+  }
+
+  // eight bytes of 0 or 1, the first in the low byte, as bits 0 to 7
+  inline uint64_t pack_bytes(const uint64_t &bytes) {
+    return (bytes * 0x0102040810204080ull) >> 56;
+  }
+
+  // bits 0 to 7 as eight bytes of 0 or 1
+  inline uint64_t unpack_bytes(const uint64_t &bits) {
+    return ((((bits & 0xFF) * 0x0101010101010101ull) & 0x8040201008040201ull) + 0x7F7F7F7F7F7F7F7Full) >> 7 & 0x0101010101010101ull;
+  }
+
+  // 1 in every byte of v that equals c, 0 in the others
+  inline uint64_t bytes_equal(const uint64_t &v, const unsigned char &c) {
+    const uint64_t t = v ^ (0x0101010101010101ull * c);
+    const uint64_t low = 0x7F7F7F7F7F7F7F7Full;
+    return ~(((t & low) + low) | t | low) >> 7;
+  }
+
+  // 8x8 bit matrix with row i in byte i, transposed
+  inline uint64_t transpose8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+  }
+
+  // adds one input bit to a 4 bit bit-sliced counter
+  inline void add_bit(uint64_t &s0, uint64_t &s1, uint64_t &s2, uint64_t &s3, uint64_t x) {
+    uint64_t c = s0 & x; s0 ^= x;
+    x = c; c = s1 & x; s1 ^= x;
+    x = c; c = s2 & x; s2 ^= x;
+    s3 |= c;
+  }
+
+  inline uint64_t count_is(const int &n, const uint64_t &s0, const uint64_t &s1, const uint64_t &s2, const uint64_t &s3) {
+    return (n & 1 ? s0 : ~s0) & (n & 2 ? s1 : ~s1) & (n & 4 ? s2 : ~s2) & (n & 8 ? s3 : ~s3);
+  }
+
+  // the neighbour counts a rule cares about, unrolled from its masks
+  struct rule_counts {
+    int birth[9];
+    int births = 0;
+    int survive[9];
+    int survivals = 0;
+    bool conway;
+
+    explicit rule_counts(const rule &r)
+      : conway(r.birth == rules::conway.birth && r.survive == rules::conway.survive)
+    {
+      for(int n = 0; n <= 8; n++) {
+        if(r.birth & (1u << n)) birth[births++] = n;
+        if(r.survive & (1u << n)) survive[survivals++] = n;
+      }
+    }
+  };
+
+  // Next generation of one two-state row on a torus. scratch must hold
+  // 6*words words.
+  void life_row(const uint64_t *above, const uint64_t *row, const uint64_t *below,
+                uint64_t *out, const int &words, const int &width,
+                const rule_counts &r, uint64_t *scratch);
+}
+
+#endif // BITROW_HPP
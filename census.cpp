@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <climits>
+
+#include "census.hpp"
+
+namespace {
+  // cropped to its bounding box; cells are unwrapped board coordinates
+  pattern from_cells(const std::vector< std::pair<int,int> > &cells) {
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    for(auto const &c : cells) {
+      x0 = std::min(x0, c.first); x1 = std::max(x1, c.first);
+      y0 = std::min(y0, c.second); y1 = std::max(y1, c.second);
+    }
+    pattern p(x1-x0+1, y1-y0+1);
+    for(auto const &c : cells) p.set(c.first-x0, c.second-y0);
+    return p;
+  }
+
+  // the i-th of the eight rotations and reflections
+  pattern transformed(const pattern &p, const int &i) {
+    const bool swap = i & 4;
+    pattern t(swap ? p.h : p.w, swap ? p.w : p.h);
+    for(int y = 0; y < p.h; y++) {
+      for(int x = 0; x < p.w; x++) {
+        if(!p.get(x, y)) continue;
+        int tx = i & 1 ? p.w-1-x : x;
+        int ty = i & 2 ? p.h-1-y : y;
+        if(swap) std::swap(tx, ty);
+        t.set(tx, ty);
+      }
+    }
+    return t;
+  }
+
+  bool shorter(const std::string &a, const std::string &b) {
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+  }
+
+  uint64_t population(const pattern &p) {
+    uint64_t live = 0;
+    for(auto w : p.bits) live += __builtin_popcountll(w);
+    return live;
+  }
+}
+
+pattern::pattern(const int &w, const int &h)
+  : w(w),
+    h(h),
+    words(bitrow::words_for(std::max(w, 1))),
+    bits((size_t)h*words, 0)
+{
+}
+
+std::string pattern::code() const {
+  static const char hex[] = "0123456789abcdef";
+  std::string s;
+  for(int y = 0; y < h; y++) {
+    if(y) s += 'z';
+    for(int x = 0; x < w; x += 4) {
+      s += hex[bitrow::get_bits(&bits[(size_t)y*words], x, std::min(4, w-x))];
+    }
+  }
+  return s;
+}
+
+void census::add(const std::string &object, const uint64_t &n) {
+  auto &s = shard_for(object);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.counts[object] += n;
+}
+
+bool census::lookup(const std::string &shape, std::string &object) {
+  auto &s = shard_for(shape);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  auto it = s.known.find(shape);
+  if(it == s.known.end()) return false;
+  object = it->second;
+  return true;
+}
+
+void census::remember(const std::string &shape, const std::string &object) {
+  auto &s = shard_for(shape);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.known[shape] = object;
+}
+
+std::vector< std::pair<std::string, uint64_t> > census::counts() {
+  std::vector< std::pair<std::string, uint64_t> > all;
+  for(auto &s : table) {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    all.insert(all.end(), s.counts.begin(), s.counts.end());
+  }
+  std::sort(all.begin(), all.end(), [](const std::pair<std::string, uint64_t> &a,
+                                       const std::pair<std::string, uint64_t> &b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+  return all;
+}
+
+census_worker::census_worker(census &shared, const rule &r)
+  : shared(shared),
+    counts(r)
+{
+}
+
+// 8-connected components of the live cells in `cells` that are also set
+// in `within`, on the torus. Coordinates are unwrapped from where the
+// search entered each component, so objects crossing an edge stay whole.
+void census_worker::components(const std::vector<uint64_t> &cells, const soup_board &board,
+                               const std::vector<uint64_t> &within,
+                               std::vector< std::vector< std::pair<int,int> > > &found) {
+  const int width = board.width, height = board.height, words = board.words;
+  auto live = [&](const int &x, const int &y) {
+    const size_t i = (size_t)y*words + x/64;
+    return (cells[i] & within[i]) >> (x%64) & 1;
+  };
+  label.assign((size_t)width*height, 0);
+  found.clear();
+  for(int y = 0; y < height; y++) {
+    for(int x = 0; x < width; x++) {
+      if(!live(x, y) || label[(size_t)y*width + x]) continue;
+      found.emplace_back();
+      auto &component = found.back();
+      queue.assign(1, std::make_pair(x, y));
+      label[(size_t)y*width + x] = 1;
+      for(size_t head = 0; head < queue.size(); head++) {
+        const int ux = queue[head].first, uy = queue[head].second;
+        component.push_back(queue[head]);
+        for(int dy = -1; dy <= 1; dy++) {
+          for(int dx = -1; dx <= 1; dx++) {
+            const int nx = ((ux+dx) % width + width) % width;
+            const int ny = ((uy+dy) % height + height) % height;
+            if(!live(nx, ny) || label[(size_t)ny*width + nx]) continue;
+            label[(size_t)ny*width + nx] = 1;
+            queue.emplace_back(ux+dx, uy+dy);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Objects are the live cells of each component of the union of all
+// phases, so oscillators whose phases fall apart stay together. A
+// component is first split into its connected pieces, which is right for
+// ash that merely passed close by; if any piece misbehaves on its own the
+// component is classified whole.
+void census_worker::survey(soup_board &board, const int &period) {
+  sum = board.cur;
+  for(int i = 0; i < period; i++) {
+    board.step();
+    for(size_t w = 0; w < sum.size(); w++) sum[w] |= board.cur[w];
+  }
+
+  std::vector< std::vector< std::pair<int,int> > > groups, pieces;
+  components(sum, board, sum, groups);
+  std::vector<uint64_t> within(sum.size());
+  std::vector<std::string> objects;
+  for(auto const &group : groups) {
+    std::fill(within.begin(), within.end(), 0);
+    std::vector< std::pair<int,int> > live;
+    for(auto const &c : group) {
+      const int x = ((c.first % board.width) + board.width) % board.width;
+      const int y = ((c.second % board.height) + board.height) % board.height;
+      within[(size_t)y*board.words + x/64] |= uint64_t(1) << (x%64);
+      if((board.cur[(size_t)y*board.words + x/64] >> (x%64)) & 1) live.push_back(c);
+    }
+    if(live.empty()) continue;
+
+    components(board.cur, board, within, pieces);
+    objects.clear();
+    bool whole = false;
+    for(auto const &piece : pieces) {
+      auto object = classify(from_cells(piece));
+      if(object.empty()) {
+        whole = true;
+        break;
+      }
+      objects.push_back(object);
+    }
+    if(whole) {
+      auto object = classify(from_cells(live));
+      shared.add(object.empty() ? "unclassified" : object);
+      continue;
+    }
+    for(auto const &object : objects) shared.add(object);
+  }
+}
+
+std::string census_worker::classify(const pattern &p) {
+  if(p.w > 256 || p.h > 256) return "";
+  auto const shape = p.code();
+  std::string object;
+  if(shared.lookup(shape, object)) return object;
+  object = isolate(p);
+  shared.remember(shape, object);
+  return object;
+}
+
+// Runs the object alone on a torus wide enough that nothing moving at c/2
+// comes back around within max_period generations, and waits for its
+// first shape to reappear. Returns "" if it never does.
+std::string census_worker::isolate(const pattern &p) {
+  const int pad = max_period/2 + 2;
+  const int width = p.w + 2*pad, height = p.h + 2*pad;
+  const int words = bitrow::words_for(width);
+  lab.assign((size_t)height*words, 0);
+  lab_next = lab;
+  scratch.resize(6*(size_t)words);
+  for(int y = 0; y < p.h; y++) {
+    for(int x = 0; x < p.w; x += 64) {
+      const int n = std::min(64, p.w-x);
+      bitrow::set_bits(&lab[(size_t)(y+pad)*words], x+pad, n, bitrow::get_bits(&p.bits[(size_t)y*p.words], x, n));
+    }
+  }
+
+  std::vector<pattern> phases(1, p);
+  for(int t = 1; t <= max_period; t++) {
+    for(int y = 0; y < height; y++) {
+      bitrow::life_row(&lab[(size_t)((y+height-1) % height)*words], &lab[(size_t)y*words],
+                       &lab[(size_t)((y+1) % height)*words], &lab_next[(size_t)y*words],
+                       words, width, counts, scratch.data());
+    }
+    lab.swap(lab_next);
+
+    int y0 = height, y1 = -1;
+    std::vector<uint64_t> any(words, 0);
+    for(int y = 0; y < height; y++) {
+      uint64_t row_any = 0;
+      for(int i = 0; i < words; i++) {
+        any[i] |= lab[(size_t)y*words + i];
+        row_any |= lab[(size_t)y*words + i];
+      }
+      if(row_any) {
+        y0 = std::min(y0, y);
+        y1 = y;
+      }
+    }
+    if(y1 < 0) return "";
+    int x0 = -1, x1 = -1;
+    for(int i = 0; i < words; i++) {
+      if(!any[i]) continue;
+      if(x0 < 0) x0 = i*64 + __builtin_ctzll(any[i]);
+      x1 = i*64 + 63 - __builtin_clzll(any[i]);
+    }
+    // grown to the border: whatever it is, it is not a small periodic object
+    if(x0 == 0 || y0 == 0 || x1 == width-1 || y1 == height-1) return "";
+
+    pattern phase(x1-x0+1, y1-y0+1);
+    for(int y = 0; y < phase.h; y++) {
+      for(int x = 0; x < phase.w; x += 64) {
+        const int n = std::min(64, phase.w-x);
+        bitrow::set_bits(&phase.bits[(size_t)y*phase.words], x, n,
+                         bitrow::get_bits(&lab[(size_t)(y+y0)*words], x+x0, n));
+      }
+    }
+
+    if(!(phase == p)) {
+      phases.push_back(phase);
+      continue;
+    }
+
+    const bool moved = x0 != pad || y0 != pad;
+    std::string best;
+    for(auto const &q : phases) {
+      for(int i = 0; i < 8; i++) {
+        auto const code = transformed(q, i).code();
+        if(best.empty() || shorter(code, best)) best = code;
+      }
+    }
+    if(moved) return "xq" + std::to_string(t) + "_" + best;
+    if(t == 1) return "xs" + std::to_string(population(p)) + "_" + best;
+    return "xp" + std::to_string(t) + "_" + best;
+  }
+  return "";
+}
@@ -0,0 +1,86 @@
+#ifndef CENSUS_HPP
+#define CENSUS_HPP
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bitrow.hpp"
+#include "soup.hpp"
+
+// A cropped object, rows packed 64 cells per word like bitrow rows.
+struct pattern {
+  int w;
+  int h;
+  int words;
+  std::vector<uint64_t> bits;
+
+  pattern(const int &w = 0, const int &h = 0);
+  bool get(const int &x, const int &y) const { return (bits[(size_t)y*words + x/64] >> (x%64)) & 1; }
+  void set(const int &x, const int &y) { bits[(size_t)y*words + x/64] |= uint64_t(1) << (x%64); }
+  bool operator==(const pattern &o) const { return w == o.w && h == o.h && bits == o.bits; }
+  // rows as hex digits, cell x in bit x%4 of digit x/4, rows joined by 'z'
+  std::string code() const;
+};
+
+// Object counts shared by all soup workers. The table is split into
+// shards with a lock each, so workers rarely wait on one another; the
+// shards also remember how every raw shape classified, which lets the
+// common objects skip the isolated simulation.
+class census
+{
+  static const int shards = 64;
+
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> counts;
+    std::unordered_map<std::string, std::string> known;
+  };
+
+  std::array<shard, shards> table;
+
+  shard &shard_for(const std::string &key) { return table[std::hash<std::string>()(key) % shards]; }
+
+public:
+  void add(const std::string &object, const uint64_t &n = 1);
+  bool lookup(const std::string &shape, std::string &object);
+  void remember(const std::string &shape, const std::string &object);
+  // every object with its count, most common first
+  std::vector< std::pair<std::string, uint64_t> > counts();
+};
+
+// Per-thread workspace that segments the ash of a stabilized soup into
+// objects, classifies them and adds them to the shared census.
+class census_worker
+{
+  census &shared;
+  bitrow::rule_counts counts;
+  // labels and a BFS queue over the soup board
+  std::vector<int> label;
+  std::vector< std::pair<int,int> > queue;
+  std::vector<uint64_t> sum;
+  // isolated simulation board
+  std::vector<uint64_t> lab, lab_next, scratch;
+
+  void components(const std::vector<uint64_t> &cells, const soup_board &board,
+                  const std::vector<uint64_t> &within,
+                  std::vector< std::vector< std::pair<int,int> > > &found);
+  std::string classify(const pattern &p);
+  std::string isolate(const pattern &p);
+
+public:
+  // the longest object period the isolated simulation looks for
+  static const int max_period = 64;
+
+public:
+  census_worker(census &shared, const rule &r);
+
+  // board must be in a cycle of the given period; it ends in the same state
+  void survey(soup_board &board, const int &period);
+};
+
+#endif // CENSUS_HPP
@@ -0,0 +1,143 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+
+namespace {
+  const char trailer_magic[8] = {'G', 'O', 'L', 'G', 'E', 'N', '1', '\0'};
+  const size_t trailer_size = sizeof(trailer_magic) + sizeof(uint64_t);
+}
+
+void append_generation(std::vector<char> &bytes, const uint64_t &generation) {
+  bytes.insert(bytes.end(), trailer_magic, trailer_magic + sizeof(trailer_magic));
+  auto const g = (const char*)&generation;
+  bytes.insert(bytes.end(), g, g + sizeof(generation));
+}
+
+bool read_generation(const char *data, const size_t &size, const size_t &cells, uint64_t &generation) {
+  if(size != cells + trailer_size) return false;
+  if(std::memcmp(data + cells, trailer_magic, sizeof(trailer_magic)) != 0) return false;
+  std::memcpy(&generation, data + cells + sizeof(trailer_magic), sizeof(generation));
+  return true;
+}
+
+checkpoint_writer::checkpoint_writer(const int &keep)
+  : busy(false),
+    stop(false),
+    keep(keep),
+    written(0),
+    dropped(0)
+{
+  worker = std::thread([this] { run(); });
+}
+
+checkpoint_writer::~checkpoint_writer() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  worker.join();
+}
+
+std::vector<char> checkpoint_writer::take_buffer() {
+  std::unique_lock<std::mutex> lock(mutex);
+  std::vector<char> buffer;
+  buffer.swap(spare);
+  return buffer;
+}
+
+void checkpoint_writer::submit(std::vector<char> &&bytes, const std::string &path, const bool &rotate) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if(rotate) {
+      for(auto it = pending.begin(); it != pending.end(); ++it) {
+        if(!it->rotate) continue;
+        spare.swap(it->bytes);
+        pending.erase(it);
+        dropped++;
+        break;
+      }
+    }
+    pending.push_back(job{std::move(bytes), path, rotate});
+  }
+  wake.notify_one();
+}
+
+void checkpoint_writer::wait_idle() {
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return pending.empty() && !busy; });
+}
+
+std::string checkpoint_writer::report() {
+  std::unique_lock<std::mutex> lock(mutex);
+  return "checkpoints: " + std::to_string(written) + " written, " + std::to_string(dropped) + " dropped";
+}
+
+void checkpoint_writer::run() {
+  for(;;) {
+    job j;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stop || !pending.empty(); });
+      // finish what was queued before shutting down
+      if(pending.empty()) return;
+      j = std::move(pending.front());
+      pending.pop_front();
+      busy = true;
+    }
+
+    write(j);
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      busy = false;
+      if(spare.capacity() < j.bytes.capacity()) spare.swap(j.bytes);
+    }
+    idle.notify_all();
+  }
+}
+
+void checkpoint_writer::write(job &j) {
+  auto const tmp = j.path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
+    std::cerr << "checkpoint " << tmp << ": " << std::strerror(errno) << "\n";
+    return;
+  }
+  const char *p = j.bytes.data();
+  size_t left = j.bytes.size();
+  while(left) {
+    ssize_t n = ::write(fd, p, left);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0) {
+      std::cerr << "checkpoint " << tmp << ": " << std::strerror(errno) << "\n";
+      ::close(fd);
+      ::unlink(tmp.c_str());
+      return;
+    }
+    p += n;
+    left -= n;
+  }
+  ::fsync(fd);
+  ::close(fd);
+  if(std::rename(tmp.c_str(), j.path.c_str()) != 0) {
+    std::cerr << "checkpoint " << j.path << ": " << std::strerror(errno) << "\n";
+    ::unlink(tmp.c_str());
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  written++;
+  if(!j.rotate) return;
+  kept.push_back(j.path);
+  while(keep > 0 && (int)kept.size() > keep) {
+    std::remove(kept.front().c_str());
+    kept.pop_front();
+  }
+}
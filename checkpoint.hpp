@@ -0,0 +1,64 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes generation snapshots from a background thread. The stepping
+// thread only copies the grid into a buffer and hands it over; files are
+// written to a temporary name, synced and renamed into place, so a crash
+// never leaves a half written snapshot behind. Rotating snapshots keep
+// only the newest `keep` files.
+class checkpoint_writer
+{
+  struct job {
+    std::vector<char> bytes;
+    std::string path;
+    bool rotate;
+  };
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::deque<job> pending;
+  std::vector<char> spare;
+  std::deque<std::string> kept;
+  bool busy;
+  bool stop;
+  std::thread worker;
+
+  void run();
+  void write(job &j);
+
+public:
+  int keep;
+  unsigned long written;
+  unsigned long dropped;
+
+public:
+  checkpoint_writer(const int &keep = 3);
+  ~checkpoint_writer();
+
+  // a buffer to fill with the next snapshot, reused between snapshots
+  std::vector<char> take_buffer();
+  // Queues a snapshot. A rotating snapshot replaces one that is still
+  // waiting, so a slow disk never holds up the simulation.
+  void submit(std::vector<char> &&bytes, const std::string &path, const bool &rotate);
+  void wait_idle();
+  // snapshots written and rotating ones dropped for a newer one
+  std::string report();
+};
+
+// Checkpoints and dumps end in a trailer with their generation, after
+// the one byte per cell of world::snapshot.
+void append_generation(std::vector<char> &bytes, const uint64_t &generation);
+// False when the cells bytes at data are not followed by a trailer.
+bool read_generation(const char *data, const size_t &size, const size_t &cells, uint64_t &generation);
+
+#endif // CHECKPOINT_HPP
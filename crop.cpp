@@ -0,0 +1,68 @@
+#include <initializer_list>
+
+#include "crop.hpp"
+
+span crop::whole(const int &n) {
+  return span{0, n};
+}
+
+span crop::cover(const std::vector<char> &occupied) {
+  const int n = (int)occupied.size();
+  int first = 0;
+  while(first < n && !occupied[first]) first++;
+  if(first == n) return span{0, 0};
+
+  // walk once around from an occupied entry; the span starts right
+  // after the longest run of empty entries
+  int gap = 0, best_gap = 0, best_start = first;
+  for(int k = 1; k <= n; k++) {
+    const int i = (first+k) % n;
+    if(!occupied[i]) {
+      gap++;
+      continue;
+    }
+    if(gap > best_gap) {
+      best_gap = gap;
+      best_start = i;
+    }
+    gap = 0;
+  }
+  if(best_gap == 0) return whole(n);
+  return span{best_start, n-best_gap};
+}
+
+span crop::grow(const span &s, const int &n, const int &margin) {
+  if(s.length == 0) return s;
+  if(s.length + 2*margin >= n) return whole(n);
+  return span{((s.from - margin) % n + n) % n, s.length + 2*margin};
+}
+
+span crop::join(const span &a, const span &b, const int &n) {
+  if(a.length == 0) return b;
+  if(b.length == 0) return a;
+  if(a.full(n) || b.full(n)) return whole(n);
+  std::vector<char> occupied(n, 0);
+  for(auto const &s : {a, b}) {
+    for(int i = 0; i < s.length; i++) occupied[(s.from+i) % n] = 1;
+  }
+  return cover(occupied);
+}
+
+void crop::pieces(const span &s, const int &n, std::vector< std::pair<int,int> > &out) {
+  out.clear();
+  if(s.length == 0) return;
+  if(s.full(n)) {
+    out.emplace_back(0, n);
+    return;
+  }
+  if(s.from + s.length <= n) {
+    out.emplace_back(s.from, s.from + s.length);
+    return;
+  }
+  out.emplace_back(s.from, n);
+  out.emplace_back(0, s.from + s.length - n);
+}
+
+bool crop::touches_edge(const span &s, const int &n) {
+  return s.length > 0 && (s.full(n) || s.from == 0 || s.from + s.length >= n);
+}
@@ -0,0 +1,35 @@
+#ifndef CROP_HPP
+#define CROP_HPP
+
+#include <utility>
+#include <vector>
+
+// A run of cells along one axis of the torus, n cells around: from,
+// from+1, ... length cells, wrapping past n-1 to 0. Length 0 is empty,
+// length n the whole axis.
+struct span {
+  int from;
+  int length;
+
+  bool full(const int &n) const { return length >= n; }
+};
+
+struct crop_box {
+  span x;
+  span y;
+};
+
+namespace crop {
+  span whole(const int &n);
+  // the shortest span holding every set entry, around the largest gap
+  span cover(const std::vector<char> &occupied);
+  // grown by margin on both sides
+  span grow(const span &s, const int &n, const int &margin);
+  // the shortest span holding both
+  span join(const span &a, const span &b, const int &n);
+  // the one or two [from, to) ranges of s without wrapping
+  void pieces(const span &s, const int &n, std::vector< std::pair<int,int> > &out);
+  bool touches_edge(const span &s, const int &n);
+}
+
+#endif // CROP_HPP
@@ -0,0 +1,91 @@
+#include <algorithm>
+
+#include "density.hpp"
+#include "world.hpp"
+
+density_pyramid::density_pyramid(const int &width, const int &height)
+  : width(width),
+    height(height)
+{
+  int lw = (width+block_size-1)/block_size;
+  int lh = (height+block_size-1)/block_size;
+  for(;;) {
+    level_width.push_back(lw);
+    level_height.push_back(lh);
+    levels.emplace_back((size_t)lw*lh, 0);
+    queued.emplace_back((size_t)lw*lh, 0);
+    pending.emplace_back();
+    if(lw <= 1 && lh <= 1) break;
+    lw = (lw+1)/2;
+    lh = (lh+1)/2;
+  }
+}
+
+int density_pyramid::level_for(const double &cells_per_pixel) const {
+  int level = 0;
+  while(level+1 < (int)levels.size() && cells_per_block(level) < cells_per_pixel) level++;
+  return level;
+}
+
+void density_pyramid::queue(const int &level, const int &index) {
+  if(queued[level][index]) return;
+  queued[level][index] = 1;
+  pending[level].push_back(index);
+}
+
+void density_pyramid::update(const world &w, const std::vector<char> &segments, const std::vector<int> &rows) {
+  const int blocks_per_segment = world::segment_width/block_size;
+  for(auto y : rows) {
+    const char *row = &segments[(size_t)y*w.segments_per_row];
+    for(int s = 0; s < w.segments_per_row; s++) {
+      if(!row[s]) continue;
+      const int first = s*blocks_per_segment;
+      const int last = std::min(level_width[0], first+blocks_per_segment);
+      for(int bx = first; bx < last; bx++) {
+        queue(0, (y/block_size)*level_width[0] + bx);
+      }
+    }
+  }
+
+  for(int index : pending[0]) {
+    const int bx = index % level_width[0];
+    const int by = index / level_width[0];
+    const int x0 = bx*block_size, x1 = std::min(width, x0+block_size);
+    const int y0 = by*block_size, y1 = std::min(height, y0+block_size);
+    uint32_t live = 0;
+    if(w.multi_state()) {
+      for(int x = x0; x < x1; x++)
+        for(int y = y0; y < y1; y++)
+          live += w.states.get(x, y) == 1;
+    }
+    else {
+      for(int x = x0; x < x1; x++)
+        for(int y = y0; y < y1; y++)
+          live += w.cells[x][y].alive;
+    }
+    levels[0][index] = live;
+  }
+
+  for(size_t level = 0; level < levels.size(); level++) {
+    const int lw = level_width[level];
+    if(level > 0) {
+      const int cw = level_width[level-1], ch = level_height[level-1];
+      const auto &child = levels[level-1];
+      for(int index : pending[level]) {
+        const int cx = (index % lw)*2, cy = (index / lw)*2;
+        uint32_t live = child[(size_t)cy*cw + cx];
+        if(cx+1 < cw) live += child[(size_t)cy*cw + cx+1];
+        if(cy+1 < ch) live += child[(size_t)(cy+1)*cw + cx];
+        if(cx+1 < cw && cy+1 < ch) live += child[(size_t)(cy+1)*cw + cx+1];
+        levels[level][index] = live;
+      }
+    }
+    for(int index : pending[level]) {
+      queued[level][index] = 0;
+      if(level+1 < levels.size()) {
+        queue(level+1, ((index / lw)/2)*level_width[level+1] + (index % lw)/2);
+      }
+    }
+    pending[level].clear();
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef DENSITY_HPP
+#define DENSITY_HPP
+
+#include <cstdint>
+#include <vector>
+
+class world;
+
+// Live-cell counts per block of the world. Level 0 blocks are
+// block_size x block_size cells, every further level sums 2x2 blocks of
+// the level below, up to a single block covering the whole world.
+// Only blocks under changed segments are recounted.
+class density_pyramid
+{
+public:
+  static const int block_size = 8;
+  int width;
+  int height;
+  std::vector<int> level_width;
+  std::vector<int> level_height;
+  std::vector< std::vector<uint32_t> > levels;
+
+private:
+  std::vector< std::vector<char> > queued;
+  std::vector< std::vector<int> > pending;
+
+  void queue(const int &level, const int &index);
+
+public:
+  density_pyramid(const int &width = 0, const int &height = 0);
+
+  int cells_per_block(const int &level) const { return block_size << level; }
+  int level_for(const double &cells_per_pixel) const;
+  uint32_t count(const int &level, const int &bx, const int &by) const {
+    return levels[level][(size_t)by*level_width[level] + bx];
+  }
+
+  // segments and their rows as handed out by world::take_dirty_segments
+  void update(const world &w, const std::vector<char> &segments, const std::vector<int> &rows);
+};
+
+#endif // DENSITY_HPP
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "distributed.hpp"
+#include "bitrow.hpp"
+#include "random.hpp"
+
+namespace {
+  // the most square px x py factorisation of size
+  void factor(const int &size, int &px, int &py) {
+    py = 1;
+    for(int f = 1; f*f <= size; f++) {
+      if(size % f == 0) py = f;
+    }
+    px = size/py;
+  }
+
+  int64_t split_start(const int64_t &total, const int &parts, const int &i) {
+    return total/parts*i + std::min<int64_t>(i, total%parts);
+  }
+}
+
+domain::domain(const int &rank, const int &size, const int64_t &width, const int64_t &height,
+               const int &halo, const rule &r)
+  : k(halo),
+    life_rule(r)
+{
+  factor(size, px, py);
+  rx = rank % px;
+  ry = rank / px;
+  gx = split_start(width, px, rx);
+  gy = split_start(height, py, ry);
+  w = (int)(split_start(width, px, rx+1) - gx);
+  h = (int)(split_start(height, py, ry+1) - gy);
+  if(k < 1 || k > 32 || k > w || k > h) {
+    throw std::invalid_argument("halo must be between 1 and 32 and fit into every rank's rectangle");
+  }
+
+  pw = w + 2*k;
+  ph = h + 2*k;
+  words = bitrow::words_for(pw);
+  cur.assign((size_t)ph*words, 0);
+  prev = prev2 = next = cur;
+  scratch.resize(6*(size_t)words);
+
+  east = ry*px + (rx+1) % px;
+  west = ry*px + (rx+px-1) % px;
+  north = ((ry+py-1) % py)*px + rx;
+  south = ((ry+1) % py)*px + rx;
+}
+
+// Draws the words of the global board that overlap the owned rectangle,
+// so the board does not depend on how many ranks share it.
+void domain::seed_life(const uint64_t &seed, const int &percent) {
+  const bulk_random bulk(bulk_random::board_seed(seed, 0), percent);
+  for(int y = 0; y < h; y++) {
+    const uint64_t stream = bulk.stream(gy+y);
+    for(int64_t x = gx; x < gx+w;) {
+      const int n = (int)std::min<int64_t>(64 - x%64, gx+w-x);
+      const uint64_t bits = bulk.cells(stream, x/64) >> (x%64);
+      bitrow::set_bits(row(cur, k+y), k + (int)(x-gx), n, bits);
+      x += n;
+    }
+  }
+}
+
+// East/west columns first, then north/south rows including the freshly
+// filled ghost columns, so the corners arrive without diagonal messages.
+void domain::exchange(transport &t) {
+  send_buf.resize(std::max((size_t)h, (size_t)k*words));
+  recv_buf.resize(send_buf.size());
+
+  auto columns = [this, &t] (const int &to, const int &from_x, const int &from, const int &into_x) {
+    for(int y = 0; y < h; y++) send_buf[y] = bitrow::get_bits(row(cur, k+y), from_x, k);
+    t.sendrecv(to, send_buf.data(), h*sizeof(uint64_t), from, recv_buf.data(), h*sizeof(uint64_t));
+    for(int y = 0; y < h; y++) bitrow::set_bits(row(cur, k+y), into_x, k, recv_buf[y]);
+  };
+  columns(east, w, west, 0);
+  columns(west, k, east, k+w);
+
+  auto const row_bytes = (size_t)k*words*sizeof(uint64_t);
+  auto rows = [this, &t, row_bytes] (const int &to, const int &from_y, const int &from, const int &into_y) {
+    t.sendrecv(to, row(cur, from_y), row_bytes, from, recv_buf.data(), row_bytes);
+    std::copy(recv_buf.begin(), recv_buf.begin() + (size_t)k*words, row(cur, into_y));
+  };
+  rows(south, h, north, 0);
+  rows(north, k, south, k+h);
+}
+
+void domain::step() {
+  const bitrow::rule_counts counts(life_rule);
+  for(int y = 0; y < ph; y++) {
+    bitrow::life_row(row(cur, (y+ph-1) % ph), row(cur, y), row(cur, (y+1) % ph),
+                     row(next, y), words, pw, counts, scratch.data());
+  }
+  // next becomes current, the oldest generation becomes scratch
+  std::swap(prev2, next);
+  std::swap(prev, prev2);
+  std::swap(cur, prev);
+}
+
+// stable only if every one of the steps was, not just the last
+bool domain::advance(const int &steps) {
+  bool stable = true;
+  for(int s = 0; s < steps; s++) {
+    step();
+    stable &= same_as_two_generations_ago();
+  }
+  return stable;
+}
+
+uint64_t domain::population() const {
+  uint64_t live = 0;
+  for(int y = k; y < k+h; y++) live += bitrow::count_bits(row(cur, y), k, w);
+  return live;
+}
+
+bool domain::same_as_two_generations_ago() const {
+  for(int y = k; y < k+h; y++) {
+    for(int x = k; x < k+w; x += 64) {
+      const int n = std::min(64, k+w-x);
+      if(bitrow::get_bits(row(cur, y), x, n) != bitrow::get_bits(row(prev2, y), x, n)) return false;
+    }
+  }
+  return true;
+}
+
+int run_rank(transport &t, const distributed_options &options) {
+  typedef std::chrono::steady_clock clock;
+  domain d(t.rank, t.size, options.width, options.height, options.halo, options.life_rule);
+  d.seed_life(options.seed, options.percent);
+
+  long generation = 0;
+  int stable_generations = 0;
+  auto const start = clock::now();
+  std::vector<uint64_t> stats(2);
+
+  while(options.generations < 0 || generation < options.generations) {
+    d.exchange(t);
+    int steps = d.k;
+    if(options.generations >= 0) steps = (int)std::min<long>(steps, options.generations - generation);
+    const bool stable = d.advance(steps);
+    generation += steps;
+
+    // population and "no rank changed" reduced in one message
+    stats[0] = d.population();
+    stats[1] = stable ? 0 : 1;
+    t.allreduce(stats, transport::sum);
+    stable_generations = stats[1] ? 0 : stable_generations + steps;
+
+    if(t.rank == 0) {
+      auto const seconds = std::chrono::duration<double>(clock::now() - start).count();
+      std::cerr << "generation " << generation
+                << " population " << stats[0]
+                << " " << (generation*(double)options.width*options.height/seconds/1e6) << " Mcells/s"
+                << " halo " << t.bytes_sent << " bytes sent by rank 0\n";
+    }
+    if(stable_generations > 20) {
+      if(t.rank == 0) std::cerr << "stable after " << generation << " generations\n";
+      break;
+    }
+  }
+  t.barrier();
+  return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "rule.hpp"
+#include "transport.hpp"
+
+// The part of a distributed torus owned by one rank. Ranks form a
+// px x py grid; each owns a w x h rectangle stored bit-packed with a
+// halo of k cells on every side. Halos are exchanged every k generations
+// and the rectangle is stepped k times in between; the garbage that
+// creeps in from the unexchanged border never reaches the owned cells.
+class domain
+{
+public:
+  int px, py;
+  int rx, ry;
+  int64_t gx, gy;
+  int w, h;
+  int k;
+  int pw, ph;
+  int words;
+  int east, west, north, south;
+  rule life_rule;
+  // cur, the previous two generations for stability checks, and scratch
+  std::vector<uint64_t> cur, prev, prev2, next;
+
+private:
+  std::vector<uint64_t> send_buf, recv_buf;
+  std::vector<uint64_t> scratch;
+
+  uint64_t *row(std::vector<uint64_t> &g, const int &y) { return &g[(size_t)y*words]; }
+  const uint64_t *row(const std::vector<uint64_t> &g, const int &y) const { return &g[(size_t)y*words]; }
+
+public:
+  domain(const int &rank, const int &size, const int64_t &width, const int64_t &height,
+         const int &halo, const rule &r);
+
+  void seed_life(const uint64_t &seed, const int &percent = 17);
+  void exchange(transport &t);
+  void step();
+  // steps between two exchanges; true when each of them left the owned
+  // cells as they were two generations before
+  bool advance(const int &steps);
+  uint64_t population() const;
+  bool same_as_two_generations_ago() const;
+};
+
+struct distributed_options {
+  int64_t width;
+  int64_t height;
+  int halo;
+  long generations;
+  rule life_rule;
+  uint64_t seed;
+  int percent;
+};
+
+// runs one rank to completion; rank 0 reports global stats on stderr
+int run_rank(transport &t, const distributed_options &options);
+
+#endif // DISTRIBUTED_HPP
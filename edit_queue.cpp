@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "edit_queue.hpp"
+
+brush brush::load(const std::string &filename) {
+  std::ifstream in(filename);
+  if(!in) throw std::runtime_error("could not open pattern " + filename);
+  std::vector<std::string> rows;
+  std::string row;
+  while(std::getline(in, row)) {
+    if(!row.empty() && row.back() == '\r') row.pop_back();
+    rows.push_back(row);
+  }
+  while(!rows.empty() && rows.back().empty()) rows.pop_back();
+  if(rows.empty()) throw std::runtime_error("pattern " + filename + " is empty");
+
+  brush b;
+  b.height = (int)rows.size();
+  b.width = 0;
+  for(auto const &r : rows) b.width = std::max(b.width, (int)r.size());
+  if(b.width == 0) throw std::runtime_error("pattern " + filename + " is empty");
+  b.alive.assign((size_t)b.width*b.height, 0);
+  for(int y = 0; y < b.height; y++) {
+    for(int x = 0; x < (int)rows[y].size(); x++) {
+      b.alive[(size_t)y*b.width + x] = rows[y][x] == '0' || rows[y][x] == 'O';
+    }
+  }
+  return b;
+}
+
+brush brush::glider() {
+  brush b;
+  b.width = b.height = 3;
+  b.alive = {0,1,0,
+             0,0,1,
+             1,1,1};
+  return b;
+}
+
+edit_queue::edit_queue()
+  : head(nullptr)
+{
+}
+
+edit_queue::~edit_queue() {
+  std::vector<edit> rest;
+  take(rest);
+}
+
+void edit_queue::push(edit e) {
+  node *n = new node{std::move(e), head.load(std::memory_order_relaxed)};
+  while(!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+// the list is newest first, so it is reversed on the way out
+void edit_queue::take(std::vector<edit> &out) {
+  node *n = head.exchange(nullptr, std::memory_order_acquire);
+  auto const first = out.size();
+  while(n) {
+    out.push_back(std::move(n->e));
+    node *next = n->next;
+    delete n;
+    n = next;
+  }
+  std::reverse(out.begin()+first, out.end());
+}
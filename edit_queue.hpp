@@ -0,0 +1,57 @@
+#ifndef EDIT_QUEUE_HPP
+#define EDIT_QUEUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A rectangle of cells to paste, row-major.
+struct brush {
+  int width;
+  int height;
+  std::vector<char> alive;
+
+  bool get(const int &x, const int &y) const { return alive[(size_t)y*width + x]; }
+
+  // plaintext as in the *_40x16.txt patterns: '0' or 'O' alive, anything
+  // else dead, one row per line; throws std::runtime_error
+  static brush load(const std::string &filename);
+  static brush glider();
+};
+
+// One change to the board. A line sets every cell from (x0,y0) to (x1,y1)
+// to the value of the alive field, state 1 when true and state 0 when
+// false; a paste overwrites the pattern's rectangle at (x0,y0).
+struct edit {
+  enum kind_t { line, paste };
+  kind_t kind;
+  int x0, y0, x1, y1;
+  bool alive;
+  std::shared_ptr<const brush> pattern;
+};
+
+// Edits from the UI on their way to the world, which applies them between
+// generations. Pushing is a single compare-and-swap and never waits on
+// the consumer; the consumer takes everything queued at once.
+class edit_queue
+{
+  struct node {
+    edit e;
+    node *next;
+  };
+  std::atomic<node*> head;
+
+public:
+  edit_queue();
+  ~edit_queue();
+  edit_queue(const edit_queue &) = delete;
+  edit_queue &operator=(const edit_queue &) = delete;
+
+  void push(edit e);
+  bool empty() const { return head.load(std::memory_order_relaxed) == nullptr; }
+  // appends the queued edits to out, oldest first
+  void take(std::vector<edit> &out);
+};
+
+#endif // EDIT_QUEUE_HPP
@@ -0,0 +1,35 @@
+#include "fixed_world.hpp"
+#include "world.hpp"
+
+template<int W, int H>
+void fixed_world<W, H>::load(const cell_grid &cells, const cell_grid &last_gen) {
+  for(int y = 0; y < H; y++) {
+    uint64_t row = 0, last = 0;
+    for(int x = 0; x < W; x++) {
+      row |= uint64_t(cells[x][y].alive) << x;
+      last |= uint64_t(last_gen[x][y].alive) << x;
+    }
+    cur[y] = row;
+    prev[y] = last;
+  }
+  // unknown, so no false stability right after a load
+  prev2.fill(~uint64_t(0));
+}
+
+template<int W, int H>
+void fixed_world<W, H>::store(cell_grid &cells, cell_grid &last_gen) const {
+  for(int x = 0; x < W; x++) {
+    for(int y = 0; y < H; y++) {
+      cells[x][y].alive = (cur[y] >> x) & 1;
+      last_gen[x][y].alive = (prev[y] >> x) & 1;
+    }
+  }
+}
+
+// the sizes of the matelight patterns in the repository
+std::unique_ptr<fixed_board> make_fixed_board(const int &width, const int &height, const rule &r) {
+  if(r.states > 2) return nullptr;
+  if(width == 40 && height == 16) return std::unique_ptr<fixed_board>(new fixed_world<40, 16>(r));
+  if(width == 50 && height == 15) return std::unique_ptr<fixed_board>(new fixed_world<50, 15>(r));
+  return nullptr;
+}
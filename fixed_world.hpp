@@ -0,0 +1,126 @@
+#ifndef FIXED_WORLD_HPP
+#define FIXED_WORLD_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bitrow.hpp"
+#include "rule.hpp"
+
+struct cell;
+
+// A two-state board small enough to step without the grid, the thread
+// pool or futures. world hands its stepping over to one when the size
+// matches a compiled specialization and copies the cells back only when
+// someone looks at them.
+class fixed_board
+{
+public:
+  virtual ~fixed_board() {}
+  // current and previous generation, cells[x][y]
+  virtual void load(const std::vector< std::vector<cell> > &cells,
+                    const std::vector< std::vector<cell> > &last_gen) = 0;
+  virtual void store(std::vector< std::vector<cell> > &cells,
+                     std::vector< std::vector<cell> > &last_gen) const = 0;
+  // one generation; bit y of the result is set if row y changed
+  virtual uint64_t step() = 0;
+  virtual bool same_as_two_generations_ago() const = 0;
+  virtual uint64_t hash() const = 0;
+  // the current generation as world::pack_board lays it out, one word per
+  // column with bit y the cell in row y
+  virtual void pack(std::vector<uint64_t> &words) const = 0;
+};
+
+// W x H torus, one word per row, cell x in bit x. With the dimensions
+// known at compile time the row loop unrolls, wrap-around rows are
+// constants and the column wrap is two shifts and a mask.
+template<int W, int H>
+class fixed_world : public fixed_board
+{
+  static_assert(W >= 2 && W <= 64 && H >= 2 && H <= 64, "rows are single words, row changes one mask");
+
+  static constexpr uint64_t mask = W == 64 ? ~uint64_t(0) : (uint64_t(1) << W) - 1;
+
+  std::array<uint64_t, H> cur, prev, prev2;
+  bitrow::rule_counts counts;
+
+  // bit x holds the cell at x-1 or x+1
+  static uint64_t west(const uint64_t &row) { return ((row << 1) | (row >> (W-1))) & mask; }
+  static uint64_t east(const uint64_t &row) { return (row >> 1) | ((row & 1) << (W-1)); }
+
+public:
+  explicit fixed_world(const rule &r)
+    : counts(r)
+  {
+    cur.fill(0);
+    prev = prev2 = cur;
+  }
+
+  void load(const std::vector< std::vector<cell> > &cells,
+            const std::vector< std::vector<cell> > &last_gen) override;
+  void store(std::vector< std::vector<cell> > &cells,
+             std::vector< std::vector<cell> > &last_gen) const override;
+
+  uint64_t step() override {
+    std::array<uint64_t, H> next;
+    for(int y = 0; y < H; y++) {
+      const uint64_t above = cur[(y+H-1) % H], row = cur[y], below = cur[(y+1) % H];
+      uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      bitrow::add_bit(s0, s1, s2, s3, west(above));
+      bitrow::add_bit(s0, s1, s2, s3, above);
+      bitrow::add_bit(s0, s1, s2, s3, east(above));
+      bitrow::add_bit(s0, s1, s2, s3, west(row));
+      bitrow::add_bit(s0, s1, s2, s3, east(row));
+      bitrow::add_bit(s0, s1, s2, s3, west(below));
+      bitrow::add_bit(s0, s1, s2, s3, below);
+      bitrow::add_bit(s0, s1, s2, s3, east(below));
+      if(counts.conway) {
+        next[y] = ~s3 & ~s2 & s1 & (s0 | row) & mask;
+        continue;
+      }
+      uint64_t born = 0, survives = 0;
+      for(int b = 0; b < counts.births; b++) born |= bitrow::count_is(counts.birth[b], s0, s1, s2, s3);
+      for(int b = 0; b < counts.survivals; b++) survives |= bitrow::count_is(counts.survive[b], s0, s1, s2, s3);
+      next[y] = ((~row & born) | (row & survives)) & mask;
+    }
+    prev2 = prev;
+    prev = cur;
+    cur = next;
+    uint64_t changed = 0;
+    for(int y = 0; y < H; y++) changed |= uint64_t(cur[y] != prev[y]) << y;
+    return changed;
+  }
+
+  bool same_as_two_generations_ago() const override {
+    return cur == prev2;
+  }
+
+  void pack(std::vector<uint64_t> &words) const override {
+    // 8x8 tiles of rows transposed into columns
+    words.assign(W, 0);
+    for(int y0 = 0; y0 < H; y0 += 8) {
+      for(int x0 = 0; x0 < W; x0 += 8) {
+        uint64_t tile = 0;
+        for(int r = 0; r < 8 && y0+r < H; r++) tile |= ((cur[y0+r] >> x0) & 0xFF) << (8*r);
+        tile = bitrow::transpose8(tile);
+        for(int c = 0; c < 8 && x0+c < W; c++) words[x0+c] |= ((tile >> (8*c)) & 0xFF) << y0;
+      }
+    }
+  }
+
+  uint64_t hash() const override {
+    uint64_t h = 0x84222325CBF29CE4ull;
+    for(auto row : cur) {
+      h = (h ^ row) * 0x100000001B3ull;
+      h ^= h >> 29;
+    }
+    return h;
+  }
+};
+
+// a fixed_world for boards of one of the compiled sizes, else nullptr
+std::unique_ptr<fixed_board> make_fixed_board(const int &width, const int &height, const rule &r);
+
+#endif // FIXED_WORLD_HPP
@@ -0,0 +1,149 @@
+#include <algorithm>
+
+#include "generations.hpp"
+#include "bitrow.hpp"
+
+using namespace bitrow;
+
+namespace {
+  int planes_for(int states) {
+    int planes = 1;
+    while((1 << planes) < states) planes++;
+    return planes;
+  }
+}
+
+state_planes::state_planes(const int &width, const int &height, const int &states)
+  : width(width),
+    height(height),
+    words((width+63)/64),
+    planes(planes_for(states)),
+    bits((size_t)height*planes*words, 0)
+{ }
+
+int state_planes::get(const int &x, const int &y) const {
+  int state = 0;
+  for(int p = 0; p < planes; p++) {
+    state |= (int)((plane(y, p)[x/64] >> (x%64)) & 1) << p;
+  }
+  return state;
+}
+
+void state_planes::set(const int &x, const int &y, const int &state) {
+  const uint64_t bit = uint64_t(1) << (x%64);
+  for(int p = 0; p < planes; p++) {
+    uint64_t &word = plane(y, p)[x/64];
+    word = (state >> p) & 1 ? word | bit : word & ~bit;
+  }
+}
+
+void state_planes::alive_row(const int &y, uint64_t *out) const {
+  const uint64_t *p0 = plane(y, 0);
+  for(int i = 0; i < words; i++) out[i] = p0[i];
+  for(int p = 1; p < planes; p++) {
+    const uint64_t *pp = plane(y, p);
+    for(int i = 0; i < words; i++) out[i] &= ~pp[i];
+  }
+}
+
+void state_planes::states_row(const int &y, uint8_t *out) const {
+  std::fill(out, out+width, 0);
+  for(int p = 0; p < planes; p++) {
+    const uint64_t *pp = plane(y, p);
+    for(int x = 0; x < width; x++) {
+      out[x] |= (uint8_t)(((pp[x/64] >> (x%64)) & 1) << p);
+    }
+  }
+}
+
+bool state_planes::row_equal(const state_planes &other, const int &y) const {
+  const uint64_t *a = plane(y, 0);
+  const uint64_t *b = other.plane(y, 0);
+  return std::equal(a, a + (size_t)planes*words, b);
+}
+
+void step_generations(const state_planes &src, state_planes &dst, const rule &r,
+                      const int &from_y, const int &to_y, std::vector<char> &changed) {
+  const int words = src.words;
+  const int planes = src.planes;
+  const int width = src.width;
+  const int height = src.height;
+
+  // alive rows above, at and below y plus their shifted copies
+  std::vector<uint64_t> scratch((size_t)words*9);
+  uint64_t *rows[3], *west[3], *east[3];
+  for(int k = 0; k < 3; k++) {
+    rows[k] = &scratch[(size_t)words*k];
+    west[k] = &scratch[(size_t)words*(3+k)];
+    east[k] = &scratch[(size_t)words*(6+k)];
+  }
+  std::vector<uint64_t> next((size_t)words*planes);
+
+  const rule_counts counts(r);
+
+  // state value that wraps back to dead, as a per-plane bit pattern
+  const int wrap = r.states;
+
+  for(int y = from_y; y < to_y; y++) {
+    for(int k = 0; k < 3; k++) {
+      src.alive_row((y+k-1+height) % height, rows[k]);
+      shift_west(rows[k], west[k], words, width);
+      shift_east(rows[k], east[k], words, width);
+    }
+
+    const uint64_t *cur0 = src.plane(y, 0);
+    for(int i = 0; i < words; i++) {
+      uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      add_bit(s0, s1, s2, s3, west[0][i]);
+      add_bit(s0, s1, s2, s3, rows[0][i]);
+      add_bit(s0, s1, s2, s3, east[0][i]);
+      add_bit(s0, s1, s2, s3, west[1][i]);
+      add_bit(s0, s1, s2, s3, east[1][i]);
+      add_bit(s0, s1, s2, s3, west[2][i]);
+      add_bit(s0, s1, s2, s3, rows[2][i]);
+      add_bit(s0, s1, s2, s3, east[2][i]);
+
+      uint64_t born = 0, survives = 0;
+      for(int b = 0; b < counts.births; b++) born |= count_is(counts.birth[b], s0, s1, s2, s3);
+      for(int b = 0; b < counts.survivals; b++) survives |= count_is(counts.survive[b], s0, s1, s2, s3);
+
+      uint64_t any = cur0[i];
+      for(int p = 1; p < planes; p++) any |= src.plane(y, p)[i];
+      const uint64_t alive = rows[1][i];
+      const uint64_t dead = ~any;
+      const uint64_t dying = any & ~alive;
+
+      const uint64_t to_one = (dead & born) | (alive & survives);
+      uint64_t carry = dying | (alive & ~survives);
+
+      // increment the decaying cells, then send state == states back to 0
+      uint64_t at_wrap = ~uint64_t(0);
+      for(int p = 0; p < planes; p++) {
+        const uint64_t v = src.plane(y, p)[i];
+        const uint64_t sum = v ^ carry;
+        carry &= v;
+        next[(size_t)p*words + i] = sum;
+        at_wrap &= (wrap >> p) & 1 ? sum : ~sum;
+      }
+      const uint64_t incremented = dying | (alive & ~survives);
+      at_wrap &= incremented;
+
+      for(int p = 0; p < planes; p++) {
+        uint64_t &v = next[(size_t)p*words + i];
+        v &= incremented & ~at_wrap;
+        if(p == 0) v |= to_one;
+      }
+    }
+
+    for(int p = 0; p < planes; p++) next[(size_t)p*words + words-1] &= tail_mask(width);
+
+    uint64_t *out = dst.plane(y, 0);
+    const uint64_t *before = src.plane(y, 0);
+    for(int i = 0; i < words; i++) {
+      for(int p = 0; p < planes; p++) {
+        if(next[(size_t)p*words + i] != before[(size_t)p*words + i]) changed[(size_t)y*words + i] = 1;
+      }
+    }
+    std::copy(next.begin(), next.end(), out);
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef GENERATIONS_HPP
+#define GENERATIONS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "rule.hpp"
+
+// Multi-state grid stored as bit planes: bit x of plane p in row y is
+// bit p of the state of cell (x,y). A row keeps its planes next to each
+// other, so stepping one row touches one contiguous block of memory.
+// Bits past width in the last word of a plane are always zero.
+class state_planes
+{
+public:
+  int width;
+  int height;
+  int words;
+  int planes;
+  std::vector<uint64_t> bits;
+
+public:
+  state_planes(const int &width = 0, const int &height = 0, const int &states = 2);
+
+  uint64_t *plane(const int &y, const int &p) { return &bits[((size_t)y*planes + p)*words]; }
+  const uint64_t *plane(const int &y, const int &p) const { return &bits[((size_t)y*planes + p)*words]; }
+
+  int get(const int &x, const int &y) const;
+  void set(const int &x, const int &y, const int &state);
+  // state == 1, the cells that count as live neighbours
+  void alive_row(const int &y, uint64_t *out) const;
+  void states_row(const int &y, uint8_t *out) const;
+  bool row_equal(const state_planes &other, const int &y) const;
+};
+
+// Steps rows [from_y, to_y) of src into dst on a torus and flags every
+// 64-cell word that changed in changed[y*words + i]. Cells are processed
+// 64 at a time with bit-sliced counters.
+void step_generations(const state_planes &src, state_planes &dst, const rule &r,
+                      const int &from_y, const int &to_y, std::vector<char> &changed);
+
+#endif // GENERATIONS_HPP
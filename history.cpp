@@ -0,0 +1,119 @@
+#include "history.hpp"
+
+history::history(const size_t &budget, const int &keyframe_every)
+  : stored(0),
+    since_key(0),
+    key_size(0),
+    budget(budget),
+    keyframe_every(keyframe_every)
+{
+}
+
+// Runs of zero words and runs of other words, each pair of runs led by a
+// word holding zeros << 32 | others. With before the words coded are
+// board XOR before.
+void history::encode(const std::vector<uint64_t> &board, const std::vector<uint64_t> *before,
+                     std::vector<uint64_t> &code) {
+  const size_t n = board.size();
+  const uint64_t *b = before ? before->data() : nullptr;
+  auto word = [&board, b] (const size_t &i) { return b ? board[i] ^ b[i] : board[i]; };
+  const size_t longest = 0xFFFFFFFF;
+  code.clear();
+  size_t i = 0;
+  while(i < n) {
+    const size_t zeros_from = i;
+    while(i < n && i - zeros_from < longest && !word(i)) i++;
+    const size_t zeros = i - zeros_from;
+    const size_t head = code.size();
+    code.push_back(0);
+    const size_t others_from = i;
+    while(i < n && i - others_from < longest && word(i)) code.push_back(word(i++));
+    code[head] = (uint64_t)zeros << 32 | (i - others_from);
+  }
+}
+
+// XORs the coded words into board
+void history::apply(const std::vector<uint64_t> &code, std::vector<uint64_t> &board) {
+  size_t i = 0, c = 0;
+  while(c < code.size()) {
+    const uint64_t head = code[c++];
+    i += head >> 32;
+    for(uint64_t k = 0; k < (head & 0xFFFFFFFF); k++) board[i++] ^= code[c++];
+  }
+}
+
+void history::record(const int &generation, const std::vector<uint64_t> &board) {
+  if(!enabled()) return;
+  bool key = frames.empty() || board.size() != newest.size() || since_key >= keyframe_every;
+  if(!key) {
+    encode(board, &newest, code);
+    // a delta as large as a keyframe only makes stepping back slower
+    if(code.size() >= key_size) key = true;
+  }
+  if(key) encode(board, nullptr, code);
+  newest = board;
+  push(generation, key);
+
+  while(stored > budget && drop_oldest()) {}
+  // the newest frames all hang off one keyframe; start another one, so
+  // the old one can go with the next frame
+  if(stored > budget) since_key = keyframe_every;
+}
+
+void history::push(const int &generation, const bool &key) {
+  frames.push_back(frame{generation, key, newest.size(), std::vector<uint64_t>(code.begin(), code.end())});
+  stored += cost(frames.back());
+  if(key) {
+    since_key = 0;
+    key_size = code.size();
+  }
+  else {
+    since_key++;
+  }
+}
+
+// drops the oldest keyframe and its deltas, unless they are the newest
+bool history::drop_oldest() {
+  size_t next = 1;
+  while(next < frames.size() && !frames[next].key) next++;
+  if(next == frames.size()) return false;
+  for(size_t i = 0; i < next; i++) {
+    stored -= cost(frames.front());
+    frames.pop_front();
+  }
+  return true;
+}
+
+void history::find_key() {
+  size_t k = frames.size();
+  while(k > 0 && !frames[k-1].key) k--;
+  since_key = (int)(frames.size() - k);
+  key_size = k > 0 ? frames[k-1].code.size() : 0;
+}
+
+bool history::back(std::vector<uint64_t> &board, int &generation) {
+  if(frames.size() < 2) return false;
+  const bool key = frames.back().key;
+  if(!key) apply(frames.back().code, newest);
+  stored -= cost(frames.back());
+  frames.pop_back();
+  find_key();
+
+  // rebuilt from the keyframe before
+  if(key) {
+    const size_t from = frames.size() - 1 - since_key;
+    newest.assign(frames[from].words, 0);
+    for(size_t i = from; i < frames.size(); i++) apply(frames[i].code, newest);
+  }
+  board = newest;
+  generation = frames.back().generation;
+  return true;
+}
+
+void history::clear() {
+  frames.clear();
+  newest.clear();
+  stored = 0;
+  since_key = 0;
+  key_size = 0;
+}
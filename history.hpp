@@ -0,0 +1,59 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// The last generations of a board, for stepping backwards within a
+// memory budget. Boards come in as packed words (see world::pack_board).
+// A keyframe keeps the whole board, every other frame only its XOR with
+// the frame before, and both are run-length coded by words, so dead or
+// unchanged space costs next to nothing. Once over budget the oldest
+// keyframe is dropped together with the frames that depend on it.
+class history
+{
+  struct frame {
+    int generation;
+    bool key;
+    size_t words;
+    std::vector<uint64_t> code;
+  };
+  std::deque<frame> frames;
+  // the board of frames.back()
+  std::vector<uint64_t> newest;
+  std::vector<uint64_t> code;
+  size_t stored;
+  // frames after the newest keyframe, and the size of its code
+  int since_key;
+  size_t key_size;
+
+  static void encode(const std::vector<uint64_t> &board, const std::vector<uint64_t> *before,
+                     std::vector<uint64_t> &code);
+  static void apply(const std::vector<uint64_t> &code, std::vector<uint64_t> &board);
+  static size_t cost(const frame &f) { return sizeof(frame) + f.code.size()*sizeof(uint64_t); }
+  void push(const int &generation, const bool &key);
+  bool drop_oldest();
+  void find_key();
+
+public:
+  // bytes, 0 keeps nothing
+  size_t budget;
+  // frames from one keyframe to the next at most
+  int keyframe_every;
+
+public:
+  history(const size_t &budget = 0, const int &keyframe_every = 256);
+
+  bool enabled() const { return budget > 0; }
+  void record(const int &generation, const std::vector<uint64_t> &board);
+  // Forgets the newest frame; board and generation become the frame
+  // before it. False when there is none.
+  bool back(std::vector<uint64_t> &board, int &generation);
+  void clear();
+  size_t size() const { return frames.size(); }
+  size_t bytes() const { return stored; }
+};
+
+#endif // HISTORY_HPP
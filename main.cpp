@@ -2,6 +2,12 @@
 #include <memory>
 #include <thread>
 #include <future>
+#include <chrono>
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
 
 #include <boost/range/irange.hpp>
 #include <boost/numeric/conversion/cast.hpp>
@@ -9,14 +15,27 @@
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
 #include "ThreadPool.h"
 
 #include "gif.h"
+#include "sdl2.hpp"
+#include "text_overlay.hpp"
+#include "viewport.hpp"
+#include "density.hpp"
 #include "world.hpp"
 #include "random.hpp"
+#include "scheduler.hpp"
+#include "mapped_world.hpp"
+#include "distributed.hpp"
+#include "soup.hpp"
+#include "profile.hpp"
+#include "tracer.hpp"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -32,23 +51,30 @@ namespace Color {
     static const SDL_Color TRANSPARENT = SDL_Color{0, 0, 0, 255};
 };
 
-struct SDL_Deleter {
-    void operator()(SDL_Window* w) const { SDL_DestroyWindow(w); }
-    void operator()(SDL_Renderer* r) const { SDL_DestroyRenderer(r); }
-    void operator()(SDL_Texture* t) const { SDL_DestroyTexture(t); }
-    void operator()(SDL_Surface* t) const { SDL_FreeSurface(t); }
-    void operator()(TTF_Font* t) const { TTF_CloseFont(t); }
-};
+inline Uint32 to_argb(const SDL_Color &c) {
+    return 0xFF000000|(c.r<<16)|(c.g<<8)|c.b;
+}
 
-namespace sdl2
-{
-    typedef std::unique_ptr<SDL_Window, SDL_Deleter> window_ptr_t;
-    typedef std::unique_ptr<SDL_Renderer, SDL_Deleter> renderer_ptr_t;
-    typedef std::unique_ptr<SDL_Texture, SDL_Deleter> texture_ptr_t;
-    typedef std::unique_ptr<SDL_Surface, SDL_Deleter> surface_ptr_t;
-    typedef std::unique_ptr<TTF_Font, SDL_Deleter> font_ptr_t;
+// Expands 2-bit cell codes (alive | last_alive<<1) into ARGB pixels.
+// The palette lookup is done with masks instead of an indexed load so
+// the loop stays branch- and gather-free and vectorizes.
+inline void expand_cell_codes(const Uint8 *codes, Uint32 *out, int n, const std::array<Uint32,4> &palette) {
+    const Uint32 p0 = palette[0], p01 = palette[0]^palette[1];
+    const Uint32 p2 = palette[2], p23 = palette[2]^palette[3];
+    for(int i = 0; i < n; i++) {
+        const Uint32 alive = 0u - (Uint32)(codes[i] & 1);
+        const Uint32 last = 0u - (Uint32)(codes[i] >> 1);
+        const Uint32 lo = p0 ^ (alive & p01);
+        const Uint32 hi = p2 ^ (alive & p23);
+        out[i] = lo ^ (last & (lo ^ hi));
+    }
 }
 
+inline void expand_state_codes(const Uint8 *codes, Uint32 *out, int n, const std::vector<Uint32> &palette) {
+    for(int i = 0; i < n; i++) {
+        out[i] = palette[codes[i]];
+    }
+}
 
 class GameWindow {
 public:
@@ -56,63 +82,121 @@ public:
     sdl2::window_ptr_t window;
     sdl2::renderer_ptr_t renderer;
     sdl2::texture_ptr_t cells_texture;
-    sdl2::surface_ptr_t surface;
     SDL_Event event;
     world w;
     sdl2::font_ptr_t font;
+    std::unique_ptr<text_overlay> overlay;
     bool evolution = false;
     bool write_gif = false;
     bool write_out = false;
     bool random_colors = false;
     int scale;
     int generations = -1;
-    double speed_factor = 1;
-    Uint64 frames = 1;
-    Uint32 last_ticks;
+    step_scheduler scheduler;
     string fps_text = "FPS: 0";
     std::unique_ptr<random_gen> color_random;
     SDL_Color current_color;
     GifWriter gifWriter;
-    Uint32 delta = 1;
-    ThreadPool pool;
+    // rendering and encoding run on the world's workers, behind stepping
+    ThreadPool &pool;
     std::vector< std::future<void> > results;
+    std::vector<Uint32> encode_pixels;
+    std::vector<Uint8> encode_bytes;
+    std::future<void> encoded;
+    // --profile; set once the workers are running
+    std::unique_ptr<perf_profile> profile;
+    // --trace; written on exit
+    std::unique_ptr<tracer> trace;
+    std::string trace_file;
     SDL_Rect text_pos{16,16,220,32};
+    std::vector<Uint32> pixels;
+    std::vector<char> dirty_segments;
+    std::vector<int> dirty_rows;
+    std::vector<int> dirty_list;
+    // dirty_list entries of render worker i are render_bounds[i] to render_bounds[i+1]
+    std::vector<size_t> render_bounds;
+    std::vector<size_t> dirty_weight;
+    std::vector< std::vector<Uint8> > row_codes;
+    bool redraw = true;
+    // left drag paints; starting on a live cell erases instead
+    bool drawing = false;
+    bool draw_alive = true;
+    int draw_x = 0;
+    int draw_y = 0;
+    // pasted at the cursor with V
+    std::shared_ptr<const brush> clipboard;
+    // zoom/pan; worlds too big for one texture or zoomed far out are drawn
+    // into a screen sized texture instead of the per-cell one
+    viewport view;
+    viewport drawn_view;
+    bool view_stale = true;
+    std::unique_ptr<density_pyramid> pyramid;
+    sdl2::texture_ptr_t view_texture;
+    std::vector<Uint32> view_pixels;
+    // cells per screen pixel from which the density pyramid is used
+    static constexpr double lod_threshold = density_pyramid::block_size;
+    static const int max_texture_size = 4096;
+    static const int max_window_w = 1600;
+    static const int max_window_h = 1000;
+
+    static bool fits_texture(int width, int height) {
+        return width <= max_texture_size && height <= max_texture_size;
+    }
+
+    static double window_scale(int width, int height, int scale) {
+        return std::min((double)scale, std::min((double)max_window_w/width, (double)max_window_h/height));
+    }
 
 public:
-    GameWindow(int width, int height, int scale, bool write_gif, bool write_out, const int &cpu_threads, const int &gpu_threads)
+    GameWindow(int width, int height, int scale, bool write_gif, bool write_out, const int &threads)
             : scale(scale),
-              w(width, height, cpu_threads),
+              w(width, height, threads),
               write_gif(write_gif),
               write_out(write_out),
-              pool(gpu_threads),
+              pool(w.pool),
               color_random(new random_gen(0,255)),
-              window(SDL_CreateWindow("Game of Life", 0, 0, width*scale, height*scale, 0), SDL_Deleter()),
-              surface(SDL_CreateRGBSurfaceFrom(NULL, width, height, 32, 0,
-                                               0x00FF0000,
-                                               0x0000FF00,
-                                               0x000000FF,
-                                               0xFF000000), SDL_Deleter()),
+              window(SDL_CreateWindow("Game of Life", 0, 0,
+                                      std::max(1, (int)(width*window_scale(width, height, scale))),
+                                      std::max(1, (int)(height*window_scale(width, height, scale))), 0),
+                     SDL_Deleter()),
               renderer(SDL_CreateRenderer(window.get(), 0, SDL_RENDERER_ACCELERATED), SDL_Deleter()),
-              cells_texture(SDL_CreateTexture(
+              cells_texture(fits_texture(width, height) ? SDL_CreateTexture(
                 renderer.get(),
                 SDL_PIXELFORMAT_ARGB8888,
                 SDL_TEXTUREACCESS_STREAMING,
                 width,
-                height),
+                height) : nullptr,
                 SDL_Deleter()),
-              font(TTF_OpenFont("arial.ttf", 32), SDL_Deleter())
+              font(TTF_OpenFont("arial.ttf", 32), SDL_Deleter()),
+              clipboard(std::make_shared<brush>(brush::glider()))
     {
         w.ratio_w = (width / w.width);
         w.ratio_h = (height / w.height);
+        if(cells_texture) {
+            pixels.assign(width*height, to_argb(Color::BLACK));
+        }
+        else if(write_gif || write_out) {
+            cerr << "world is too large for --gif and --stdout, disabling them\n";
+            this->write_gif = false;
+            this->write_out = false;
+        }
+        row_codes.assign(pool.workers.size(), std::vector<Uint8>(width));
+        int window_w, window_h;
+        SDL_GetWindowSize(window.get(), &window_w, &window_h);
+        view = viewport(window_w, window_h, width, height);
+        if(view.cells_per_pixel() >= lod_threshold) {
+            pyramid.reset(new density_pyramid(width, height));
+        }
         w.seed_life();
-        last_ticks = SDL_GetTicks();
         current_color = get_random_color();
-        if(write_gif) {
+        overlay.reset(new text_overlay(renderer.get(), font.get(), Color::WHITE));
+        if(this->write_gif) {
             GifBegin(&gifWriter, std::string("GoL_"+w.last_dump_str+".gif").c_str(), width, height, 24);
         }
     }
 
     ~GameWindow() {
+        finish_encoding();
         if(write_gif) {
              GifEnd(&gifWriter);
         }
@@ -134,9 +218,35 @@ public:
                 case SDL_KEYDOWN:
                     buttonDown();
                     break;
+                case SDL_MOUSEBUTTONDOWN:
+                    if(event.button.button == SDL_BUTTON_LEFT) {
+                        draw_x = cell_x(event.button.x);
+                        draw_y = cell_y(event.button.y);
+                        draw_alive = !(draw_x >= 0 && draw_y >= 0 && draw_x < w.width && draw_y < w.height &&
+                                       w.cell_state(draw_x, draw_y));
+                        drawing = true;
+                        paint_to(draw_x, draw_y);
+                    }
+                    break;
+                case SDL_MOUSEBUTTONUP:
+                    if(event.button.button == SDL_BUTTON_LEFT) {
+                        drawing = false;
+                    }
+                    break;
                 case SDL_MOUSEMOTION:
-                    //handleMouse();
+                    if(event.motion.state & SDL_BUTTON_RMASK) {
+                        view.pan(event.motion.xrel, event.motion.yrel);
+                    }
+                    if(drawing) {
+                        paint_to(cell_x(event.motion.x), cell_y(event.motion.y));
+                    }
+                    break;
+                case SDL_MOUSEWHEEL: {
+                    int mx, my;
+                    SDL_GetMouseState(&mx, &my);
+                    view.zoom_at(std::pow(1.25, event.wheel.y), mx, my);
                     break;
+                }
             }
         }
     }
@@ -163,109 +273,345 @@ public:
         return SDL_Color{r,g,b,a};
     }
 
+    std::array<Uint32,4> cell_palette() {
+        const cell dead{false}, alive{true};
+        return {{
+            to_argb(get_cell_color(dead, dead, random_colors)),
+            to_argb(get_cell_color(alive, dead, random_colors)),
+            to_argb(get_cell_color(dead, alive, random_colors)),
+            to_argb(get_cell_color(alive, alive, random_colors))
+        }};
+    }
+
+    // dead, live, then decaying states fading from red towards black
+    std::vector<Uint32> state_palette() {
+        auto const states = w.life_rule.states;
+        std::vector<Uint32> palette(states);
+        const cell dead{false}, alive{true};
+        palette[0] = to_argb(get_cell_color(dead, dead, random_colors));
+        palette[1] = to_argb(get_cell_color(alive, alive, random_colors));
+        for(int s = 2; s < states; s++) {
+            auto const fade = (Uint8)(255*(states-s)/(states-1));
+            palette[s] = to_argb(SDL_Color{fade, 0, 0, 0});
+        }
+        return palette;
+    }
+
+    // Only segments the world reports as changed are converted and
+    // uploaded, so a paused or mostly static board costs next to nothing
+    // per frame.
     void render_cells() {
-        SDL_LockTexture(cells_texture.get(), NULL,
-                &(surface.get())->pixels,
-                &(surface.get())->pitch);
-
-        std::vector<std::future<void>> threads;
-
-        auto w_range = boost::irange(0, w.width);
-        auto h_range = boost::irange(0, w.height);
-        auto workers = boost::irange(0, (int)pool.workers.size());
-        auto const worker_load = w.cells.size()/(pool.workers.size());
-
-        auto render_task = [this, &worker_load, w_range, h_range] (auto &worker) {
-            auto const start_w = worker*worker_load;
-            std::for_each(
-                w_range.begin()+start_w, w_range.begin()+start_w+worker_load,
-                [this, &worker, &worker_load, h_range, w_range, start_w] (int x) {
-                    std::for_each(h_range.begin(), h_range.end(), [&] (int y) {
-                        auto &c = w.cells[x][y];
-                        auto &c_last = w.last_gen[x][y];
-                        auto cell_color = get_cell_color(c, c_last, random_colors);
-                        ((Uint32*)(surface.get())->pixels)[(y*w.width+x)] =
-                                (0xFF000000|(cell_color.r<<16)|(cell_color.g<<8)|cell_color.b);
-                    });
+        bool any_dirty = w.take_dirty_segments(dirty_segments, dirty_rows);
+        if(redraw) {
+            std::fill(dirty_segments.begin(), dirty_segments.end(), 1);
+            dirty_rows.resize(w.height);
+            std::iota(dirty_rows.begin(), dirty_rows.end(), 0);
+            any_dirty = true;
+            redraw = false;
+        }
+
+        if(any_dirty) {
+            view_stale = true;
+            if(pyramid) pyramid->update(w, dirty_segments, dirty_rows);
+        }
+
+        if(any_dirty && cells_texture) {
+            // rows weighted by their dirty segments, a multi-state row is
+            // always redrawn whole
+            dirty_list.clear();
+            dirty_weight.clear();
+            size_t dirty_total = 0;
+            for(auto y : dirty_rows) {
+                auto const row = dirty_segments.begin() + y*w.segments_per_row;
+                auto const n = std::count(row, row+w.segments_per_row, 1);
+                if(!n) continue;
+                dirty_list.push_back(y);
+                dirty_weight.push_back(w.multi_state() ? w.segments_per_row : n);
+                dirty_total += dirty_weight.back();
+            }
+
+            auto const palette = cell_palette();
+            auto const states = w.multi_state() ? state_palette() : std::vector<Uint32>();
+            auto const workers = (int)pool.workers.size();
+
+            // cut the dirty rows where the running segment count passes
+            // each worker's share, so a busy corner is split over workers
+            render_bounds.assign(workers+1, dirty_list.size());
+            render_bounds[0] = 0;
+            size_t done = 0;
+            for(size_t i = 0, part = 1; i < dirty_list.size() && part < (size_t)workers; i++) {
+                while(part < (size_t)workers && done >= dirty_total*part/workers) render_bounds[part++] = i;
+                done += dirty_weight[i];
+            }
+
+            auto render_task = [this, &palette, &states] (int worker) {
+                auto &codes = row_codes[worker];
+                auto const first = render_bounds[worker];
+                auto const last = render_bounds[worker+1];
+                std::for_each(dirty_list.begin()+first, dirty_list.begin()+last, [&] (int y) {
+                    if(w.multi_state()) {
+                        w.states.states_row(y, codes.data());
+                        expand_state_codes(codes.data(), &pixels[y*w.width], w.width, states);
+                        return;
+                    }
+                    for(int s = 0; s < w.segments_per_row; s++) {
+                        if(!dirty_segments[y*w.segments_per_row + s]) continue;
+                        auto const x0 = s*world::segment_width;
+                        auto const x1 = std::min(w.width, x0+world::segment_width);
+                        for(int x = x0; x < x1; x++) {
+                            codes[x] = (Uint8)(w.cells[x][y].alive | (w.last_gen[x][y].alive << 1));
+                        }
+                        expand_cell_codes(&codes[x0], &pixels[y*w.width+x0], x1-x0, palette);
+                    }
+                });
+            };
+
+            boost::for_each(boost::irange(0, workers), [this, &render_task] (int worker) {
+                results.emplace_back(pool.enqueue_at(ThreadPool::low, render_task, worker));
+            });
+
+            boost::for_each(results, [] (auto &t) { t.wait(); });
+            results.clear();
+
+            // upload contiguous runs of dirty rows, cropped to the dirty
+            // segments, so a small pattern on a big board uploads little
+            for(size_t i = 0; i < dirty_list.size();) {
+                size_t j = i+1;
+                while(j < dirty_list.size() && dirty_list[j] == dirty_list[j-1]+1) j++;
+                int first = w.segments_per_row, last = 0;
+                for(size_t k = i; k < j; k++) {
+                    auto const row = dirty_segments.begin() + dirty_list[k]*w.segments_per_row;
+                    for(int s = 0; s < w.segments_per_row; s++) {
+                        if(!row[s]) continue;
+                        first = std::min(first, s);
+                        last = std::max(last, s+1);
+                    }
+                }
+                auto const x0 = first*world::segment_width;
+                auto const x1 = std::min(w.width, last*world::segment_width);
+                SDL_Rect rows{x0, dirty_list[i], x1-x0, (int)(j-i)};
+                SDL_UpdateTexture(cells_texture.get(), &rows, &pixels[rows.y*w.width + x0], w.width*sizeof(Uint32));
+                i = j;
+            }
+        }
+
+    }
+
+    // Hands a copy of the frame to a low priority task, so writing stdout
+    // and gif encoding overlap the next generations. Frames stay in order
+    // because each one waits for the one before.
+    void encode_frame(const bool &out, const bool &gif, const int &delay) {
+        if(!out && !gif) return;
+        finish_encoding();
+        encode_pixels = pixels;
+        encoded = pool.enqueue_at(ThreadPool::low, [this, out, gif, delay] {
+            trace_scope scope("encode");
+            if(out) {
+                // the low three bytes of every pixel
+                encode_bytes.resize(encode_pixels.size()*3);
+                for(size_t b = 0; b < encode_pixels.size(); b++) {
+                    encode_bytes[3*b] = (Uint8)encode_pixels[b];
+                    encode_bytes[3*b+1] = (Uint8)(encode_pixels[b] >> 8);
+                    encode_bytes[3*b+2] = (Uint8)(encode_pixels[b] >> 16);
+                }
+                fwrite(encode_bytes.data(), 1, encode_bytes.size(), stdout);
+                fflush(stdout);
+            }
+            if(gif) {
+                GifWriteFrame(&gifWriter, (uint8_t*)encode_pixels.data(), (uint32_t) w.width, (uint32_t) w.height, delay);
+            }
+        });
+    }
+
+    void finish_encoding() {
+        if(encoded.valid()) encoded.wait();
+    }
+
+    // waits for the last frame and writes the reports before exiting
+    void quit(const int &code) {
+        finish_encoding();
+        w.checkpoints.wait_idle();
+        if (w.checkpoint_every > 0) cerr << w.checkpoints.report() << "\n";
+        if(profile) profile->report(cerr);
+        if(trace) {
+            std::ofstream out(trace_file);
+            trace->dump(out);
+            if(!out) cerr << "could not write trace " << trace_file << "\n";
+        }
+        exit(code);
+    }
+
+    // Draws the screen sized view texture, either from the density pyramid
+    // or by sampling one cell per pixel. Cost depends on the window only.
+    void render_view() {
+        if(!view_texture) {
+            view_texture.reset(SDL_CreateTexture(renderer.get(), SDL_PIXELFORMAT_ARGB8888,
+                                                 SDL_TEXTUREACCESS_STREAMING, view.screen_w, view.screen_h));
+            view_pixels.assign(view.screen_w*view.screen_h, to_argb(Color::BLACK));
+        }
+
+        auto const palette = cell_palette();
+        auto const states = w.multi_state() ? state_palette() : std::vector<Uint32>();
+        auto const lod = pyramid && view.cells_per_pixel() >= lod_threshold;
+        auto const level = lod ? pyramid->level_for(view.cells_per_pixel()) : 0;
+
+        // density to colour, from black to the live cell colour
+        std::array<Uint32, 256> ramp;
+        auto const live = palette[3];
+        for(int i = 0; i < 256; i++) {
+            auto const v = std::sqrt(i/255.0);
+            ramp[i] = 0xFF000000 |
+                      ((Uint32)(((live >> 16) & 0xFF)*v) << 16) |
+                      ((Uint32)(((live >> 8) & 0xFF)*v) << 8) |
+                      (Uint32)((live & 0xFF)*v);
+        }
+
+        auto const workers = (int)pool.workers.size();
+        auto const worker_load = (view.screen_h+workers-1)/workers;
+        auto view_task = [&, this] (int worker) {
+            auto const first = std::min(view.screen_h, worker*worker_load);
+            auto const last = std::min(view.screen_h, first+worker_load);
+            for(int sy = first; sy < last; sy++) {
+                Uint32 *out = &view_pixels[sy*view.screen_w];
+                auto const wy = (int)std::floor(view.world_y(sy+0.5));
+                for(int sx = 0; sx < view.screen_w; sx++) {
+                    auto const wx = (int)std::floor(view.world_x(sx+0.5));
+                    if(wx < 0 || wy < 0 || wx >= w.width || wy >= w.height) {
+                        out[sx] = palette[0];
+                    }
+                    else if(lod) {
+                        auto const block = pyramid->cells_per_block(level);
+                        auto const count = pyramid->count(level, wx/block, wy/block);
+                        out[sx] = ramp[std::min<Uint32>(255, count*255/(block*block))];
+                    }
+                    else if(w.multi_state()) {
+                        out[sx] = states[w.states.get(wx, wy)];
+                    }
+                    else {
+                        out[sx] = palette[w.cells[wx][wy].alive | (w.last_gen[wx][wy].alive << 1)];
+                    }
                 }
-            );
+            }
         };
 
-        boost::for_each(workers, [this, &render_task, &threads, w_range, &worker_load, h_range] (int worker) {
-            results.emplace_back(pool.enqueue(render_task, worker));
+        boost::for_each(boost::irange(0, workers), [this, &view_task] (int worker) {
+            results.emplace_back(pool.enqueue_at(ThreadPool::low, view_task, worker));
         });
 
         boost::for_each(results, [] (auto &t) { t.wait(); });
+        results.clear();
 
-        SDL_UnlockTexture(cells_texture.get());
+        SDL_UpdateTexture(view_texture.get(), NULL, view_pixels.data(), view.screen_w*sizeof(Uint32));
+    }
 
-        if(write_out && evolution) {
-            int nullbytes = 0x00000000;
-            //fwrite(&nullbytes, 1, 3, stdout);
-            Uint32 *pixels = (Uint32*)surface.get()->pixels;
-            for(int b = 0; b < w.height*w.width; b++) {
-                int pixel = *(pixels+b);
-                fwrite(&pixel, 1, 3, stdout);
-            }
-            //fwrite(&nullbytes, 1, 3, stdout);
-            fflush(stdout);
+    void present_cells() {
+        if(cells_texture && !(pyramid && view.cells_per_pixel() >= lod_threshold)) {
+            // visible part of the world texture, scaled by the renderer
+            auto const x0 = std::floor(std::max(0.0, view.x));
+            auto const y0 = std::floor(std::max(0.0, view.y));
+            auto const x1 = std::ceil(std::min((double)w.width, view.world_x(view.screen_w)));
+            auto const y1 = std::ceil(std::min((double)w.height, view.world_y(view.screen_h)));
+            SDL_Rect src{(int)x0, (int)y0, (int)(x1-x0), (int)(y1-y0)};
+            SDL_Rect dst{(int)std::lround(view.screen_x(x0)), (int)std::lround(view.screen_y(y0)), 0, 0};
+            dst.w = (int)std::lround(view.screen_x(x1)) - dst.x;
+            dst.h = (int)std::lround(view.screen_y(y1)) - dst.y;
+            SDL_RenderCopy(renderer.get(), cells_texture.get(), &src, &dst);
+            return;
+        }
+
+        if(view_stale || view != drawn_view) {
+            render_view();
+            drawn_view = view;
+            view_stale = false;
         }
+        SDL_RenderCopy(renderer.get(), view_texture.get(), NULL, NULL);
     }
 
-    void toggle_cell() {
-        int x = 1;//input().mouseX() / w.ratio_w;
-        int y = 1;//input().mouseY() / w.ratio_h;
-        w.cells[x][y].alive = !w.cells[x][y].alive;
+    int cell_x(int sx) const {
+        return (int)std::floor(view.world_x(sx+0.5));
     }
 
-    void update() {
+    int cell_y(int sy) const {
+        return (int)std::floor(view.world_y(sy+0.5));
+    }
 
-        if (generations > -1) {
-            if (generations <= w.generation)
-                exit(generations);
-        }
-        if (evolution) {
-            w.next_generation();
-            usleep(60000*speed_factor);
-        }
+    // the UI only queues edits; the world applies them between generations
+    void paint_to(int x, int y) {
+        w.edits.push(edit{edit::line, draw_x, draw_y, x, y, draw_alive, nullptr});
+        draw_x = x;
+        draw_y = y;
+    }
 
-        render_cells();
+    void paste_at_cursor() {
+        int mx, my;
+        SDL_GetMouseState(&mx, &my);
+        w.edits.push(edit{edit::paste, cell_x(mx), cell_y(my), 0, 0, true, clipboard});
+    }
 
-        SDL_RenderClear(renderer.get());
-        SDL_RenderCopy(renderer.get(), cells_texture.get(), NULL, NULL);
+    void update() {
 
-        auto const fps = calc_fps();
-        if(frames > fps) {
-            fps_text = "FPS: "+ to_string(1000.f/delta) + " - Generation: " + to_string(w.generation);
-            frames = 1;
+        // shows painting while paused as well
+        w.apply_edits();
+        auto const cells = (double)w.width*w.height;
+        scheduler.begin_frame(evolution);
+        if (profile) profile->begin();
+        while (scheduler.step_due()) {
+            if (generations > -1 && generations <= w.generation) {
+                if (w.jumped_from >= 0) {
+                    cerr << "reached generation " << w.generation << " from " << w.jumped_from
+                         << " by skipping a cycle of period " << w.cycle_period
+                         << " that started at generation " << w.cycle_start << "\n";
+                }
+                quit(generations);
+            }
+            w.next_generation();
         }
+        auto const stepped = scheduler.generations_this_frame() > 0;
+        if (profile && stepped) profile->end("step", cells*scheduler.generations_this_frame());
 
-        sdl2::surface_ptr_t text(
-                TTF_RenderText_Shaded(font.get(), fps_text.c_str(), Color::WHITE, Color::TRANSPARENT),
-                SDL_Deleter());
-        sdl2::texture_ptr_t text_texture(
-                SDL_CreateTextureFromSurface(renderer.get(), text.get()),
-                SDL_Deleter());
+        if (profile) profile->begin();
+        {
+            trace_scope scope("render");
+            render_cells();
 
-        SDL_RenderCopy(renderer.get(), text_texture.get(), NULL, &text_pos);
-        SDL_RenderPresent(renderer.get());
+            SDL_SetRenderDrawColor(renderer.get(), 0, 0, 0, 255);
+            SDL_RenderClear(renderer.get());
+            present_cells();
 
-        if (evolution && write_gif) {
-            GifWriteFrame(&gifWriter, (uint8_t*)surface.get()->pixels, (uint32_t) w.width, (uint32_t) w.height, 0);
+            overlay->set_text(fps_text, text_pos);
+            overlay->draw(renderer.get());
+            SDL_RenderPresent(renderer.get());
         }
+        if (profile) profile->end("render", cells);
 
-        frames++;
+        if (stepped && (write_out || write_gif)) {
+            if (profile) profile->begin();
+            encode_frame(write_out, write_gif, 0);
+            // profiled frames are encoded on their own, so the counters
+            // are not mixed with the next generations
+            if (profile) {
+                finish_encoding();
+                profile->end("encode", cells);
+            }
+        }
 
-        delta = SDL_GetTicks() - last_ticks;
-        last_ticks = SDL_GetTicks();
+        if (scheduler.end_frame()) {
+            fps_text = "FPS: " + to_string((int)scheduler.achieved_fps) +
+                       " GPS: " + to_string((int)scheduler.achieved_gps) +
+                       " - Generation: " + to_string(w.generation);
+            if (w.numa_placement) fps_text += " - " + w.numa_report();
+            if (w.checkpoint_every > 0) fps_text += " - " + w.checkpoints.report();
+            if (w.jumped_from >= 0) {
+                fps_text += " - skipped " + to_string(w.jumped_from) + "->" + to_string(w.generation) +
+                            " (period " + to_string(w.cycle_period) + ")";
+            }
+        }
     }
 
-    inline Uint32 calc_fps() { return (48/(delta +1)); }
-
     void buttonDown() {
         switch (event.key.keysym.scancode) {
             case SDL_SCANCODE_ESCAPE:
-                exit(0);
+                quit(0);
             case SDL_SCANCODE_SPACE:
                 w.seed_life();
                 w.generation = 0;
@@ -281,38 +627,57 @@ public:
                 render_cells();
                 break;
             case SDL_SCANCODE_S:
-                evolution = true;
+                evolution = false;
                 w.next_generation();
                 render_cells();
-                if(write_gif) GifWriteFrame(&gifWriter, (uint8_t*)surface->pixels, w.width, w.height, 1);
-                evolution = false;
+                encode_frame(write_out, write_gif, 1);
                 break;
             case SDL_SCANCODE_P:
-                evolution = true;
                 render_cells();
-                evolution = false;
+                encode_frame(write_out, false, 0);
                 break;
             case SDL_SCANCODE_D:
                 w.dump_generation();
                 break;
             case SDL_SCANCODE_L:
-                w.load_generation("dump_" + w.last_dump_str + ".gol");
+                try {
+                    w.load_generation("dump_" + w.last_dump_str + ".gol");
+                }
+                catch(const std::runtime_error &e) {
+                    cerr << e.what() << "\n";
+                }
                 break;
             case SDL_SCANCODE_R:
                 current_color = get_random_color();
+                redraw = true;
                 break;
             case SDL_SCANCODE_O:
                 random_colors = !random_colors;
+                redraw = true;
                 break;
             case SDL_SCANCODE_K:
-                speed_factor += 0.1;
+                scheduler.set_gps(scheduler.target_gps/1.25);
                 break;
             case SDL_SCANCODE_J:
-                speed_factor -= 0.1;
+                scheduler.set_gps(scheduler.target_gps*1.25);
+                break;
+            case SDL_SCANCODE_EQUALS:
+                view.zoom_at(1.25, view.screen_w/2, view.screen_h/2);
                 break;
-            case SDL_SCANCODE_LEFT:
-                toggle_cell();
-                paint_cell = true;
+            case SDL_SCANCODE_MINUS:
+                view.zoom_at(1/1.25, view.screen_w/2, view.screen_h/2);
+                break;
+            case SDL_SCANCODE_0:
+                view.fit();
+                break;
+            case SDL_SCANCODE_V:
+                paste_at_cursor();
+                break;
+            case SDL_SCANCODE_B:
+                evolution = false;
+                if (!w.step_back() && w.rewind.enabled()) {
+                    fps_text = "no earlier generation kept - Generation: " + to_string(w.generation);
+                }
                 break;
         }
     }
@@ -322,6 +687,219 @@ public:
     }
 };
 
+// --cpu-threads, or one worker per hardware thread
+int worker_threads(const po::variables_map &vm) {
+    auto const threads = vm["cpu-threads"].as<int>();
+    if(threads > 0) return threads;
+    return (int)std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Steps a file-backed world without a window, for boards too big for RAM.
+int run_out_of_core(const po::variables_map &vm, const rule &life_rule) {
+    if(life_rule.states > 2) {
+        cerr << "--out-of-core only supports two-state rules\n";
+        return 1;
+    }
+
+    std::unique_ptr<mapped_world> mw;
+    try {
+        mw.reset(new mapped_world(vm["out-of-core"].as<std::string>(),
+                                  vm["width"].as<int>(), vm["height"].as<int>(),
+                                  worker_threads(vm), vm["strip-rows"].as<int>()));
+    }
+    catch(const std::exception &e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if(mw->created) {
+        auto const seed = vm.count("seed") ? vm["seed"].as<uint64_t>() : random_seed();
+        cerr << "seed " << seed << "\n";
+        mw->set_rule(life_rule);
+        mw->seed_life(seed, vm["density"].as<int>());
+    }
+    else if(!vm["rule"].defaulted()) {
+        mw->set_rule(life_rule);
+    }
+
+    auto const last = vm.count("generations") ? (uint64_t)vm["generations"].as<int>() : ~uint64_t(0);
+    while(mw->generation() < last) {
+        auto const start = std::chrono::steady_clock::now();
+        auto const io_before = mw->io_wait_seconds;
+        mw->next_generation();
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cerr << "generation " << mw->generation()
+             << " population " << mw->population
+             << " " << seconds << "s"
+             << " io-wait " << (mw->io_wait_seconds - io_before) << "s"
+             << " " << (mw->width*(double)mw->height/seconds/1e6) << " Mcells/s\n";
+    }
+    mw->flush();
+    return 0;
+}
+
+// Runs one rank per process. Without --rank the ranks are forked here as
+// local processes; with it each rank is started by hand with the same
+// --session.
+int run_distributed(const po::variables_map &vm, const rule &life_rule) {
+    if(life_rule.states > 2) {
+        cerr << "--ranks only supports two-state rules\n";
+        return 1;
+    }
+
+    distributed_options options;
+    options.width = vm["width"].as<int>();
+    options.height = vm["height"].as<int>();
+    options.halo = vm["halo"].as<int>();
+    options.generations = vm.count("generations") ? vm["generations"].as<int>() : -1;
+    options.life_rule = life_rule;
+    options.percent = vm["density"].as<int>();
+
+    auto const ranks = vm["ranks"].as<int>();
+    auto const kind = vm["transport"].as<std::string>();
+    auto const port = vm["port"].as<int>();
+    auto const session = vm.count("session") ? vm["session"].as<std::string>() : to_string(getpid());
+    // ranks started by hand agree on the board through the session name
+    options.seed = vm.count("seed") ? vm["seed"].as<uint64_t>()
+        : vm.count("rank") ? std::hash<std::string>()(session) : random_seed();
+    if(!vm.count("rank") || vm["rank"].as<int>() == 0) cerr << "seed " << options.seed << "\n";
+
+    auto run = [&] (int rank) {
+        try {
+            auto t = make_transport(kind, rank, ranks, session, port);
+            return run_rank(*t, options);
+        }
+        catch(const std::exception &e) {
+            cerr << "rank " << rank << ": " << e.what() << "\n";
+            return 1;
+        }
+    };
+
+    if(vm.count("rank")) {
+        return run(vm["rank"].as<int>());
+    }
+
+    std::vector<pid_t> children;
+    for(int rank = 1; rank < ranks; rank++) {
+        pid_t pid = fork();
+        if(pid == 0) _exit(run(rank));
+        if(pid < 0) {
+            cerr << "fork failed\n";
+            return 1;
+        }
+        children.push_back(pid);
+    }
+    int result = run(0);
+    for(auto pid : children) {
+        int status;
+        waitpid(pid, &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) result = 1;
+    }
+    return result;
+}
+
+// Runs an ensemble of independent soups. Each soup line goes to stdout,
+// rates and a summary to stderr.
+int run_soup_search(const po::variables_map &vm, const rule &life_rule) {
+    if(life_rule.states > 2) {
+        cerr << "--soups only supports two-state rules\n";
+        return 1;
+    }
+
+    soup_options options;
+    options.soups = vm["soups"].as<uint64_t>();
+    options.seed = vm.count("seed") ? vm["seed"].as<uint64_t>() : random_seed();
+    options.board = vm["soup-board"].as<int>();
+    options.size = vm["soup-size"].as<int>();
+    options.percent = vm["soup-density"].as<int>();
+    options.cap = vm["soup-cap"].as<int>();
+    options.threads = worker_threads(vm);
+    options.life_rule = life_rule;
+    options.census = (bool) vm.count("census");
+
+    if(options.board < 3 || options.size < 1 || options.size > options.board) {
+        cerr << "--soup-size must fit into --soup-board, which must be at least 3\n";
+        return 1;
+    }
+    if(options.percent < 0 || options.percent > 100 || options.cap < 0) {
+        cerr << "--soup-density must be a percentage and --soup-cap not negative\n";
+        return 1;
+    }
+
+    return run_soups(options, cout, cerr);
+}
+
+// Steps the same seeded board with every kernel, reports the rates and
+// checks that all kernels end on the same board.
+int run_kernel_bench(const po::variables_map &vm, const rule &life_rule) {
+    if(life_rule.states > 2) {
+        cerr << "--bench-kernels only supports two-state rules\n";
+        return 1;
+    }
+    auto const width = vm["width"].as<int>(), height = vm["height"].as<int>();
+    auto const generations = vm.count("generations") ? vm["generations"].as<int>() : 1000;
+    auto const seed = vm.count("seed") ? vm["seed"].as<uint64_t>() : random_seed();
+    auto const partitions = vm["partitions"].as<std::string>();
+    auto const boundary = vm["boundary"].as<std::string>();
+    if(partitions != "adaptive" && partitions != "even") {
+        cerr << "unknown partitioning '" << partitions << "', expected adaptive or even\n";
+        return 1;
+    }
+
+    std::unique_ptr<tracer> trace(vm.count("trace") ? new tracer() : nullptr);
+    if(trace) {
+        trace->label_thread("main");
+        tracer::active = trace.get();
+    }
+
+    int result = 0;
+    std::vector<char> reference, board;
+    for(auto const &kernel : {"auto", "table", "block"}) {
+        world w(width, height, worker_threads(vm));
+        w.set_seed(seed, vm["density"].as<int>());
+        w.seed_life();
+        w.set_rule(life_rule);
+        try {
+            w.set_boundary(boundary);
+        }
+        catch(const std::invalid_argument &e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+        w.set_kernel(kernel);
+        w.set_partitioning(partitions);
+        std::unique_ptr<perf_profile> profile(vm.count("profile") ? new perf_profile() : nullptr);
+
+        auto const start = std::chrono::steady_clock::now();
+        if(profile) profile->begin();
+        for(int g = 0; g < generations; g++) {
+            w.next_generation();
+        }
+        if(profile) profile->end(kernel, generations*(double)width*height);
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        w.snapshot(board);
+        if(reference.empty()) reference = board;
+        auto const same = board == reference;
+        if(!same) result = 1;
+        cout << kernel << ": " << (generations/seconds) << " generations/s, "
+             << (generations*(double)width*height/seconds/1e6) << " Mcells/s"
+             << (same ? "" : ", board differs from auto") << "\n";
+        if(profile) profile->report(cout);
+    }
+
+    if(trace) {
+        tracer::active = nullptr;
+        std::ofstream out(vm["trace"].as<std::string>());
+        trace->dump(out);
+        if(!out) {
+            cerr << "could not write trace " << vm["trace"].as<std::string>() << "\n";
+            return 1;
+        }
+    }
+    return result;
+}
+
 int main(int argc, char **argv) {
 
     // Declare the supported options.
@@ -335,8 +913,40 @@ int main(int argc, char **argv) {
         ("generations,g", po::value<int>(), "stop after given number of generations")
         ("gif", "create gif")
         ("stdout", "write frame bytes to stdout")
-        ("cpu-threads,c", po::value<int>()->default_value(1), "cpu threads")
-        ("gpu-threads,d", po::value<int>()->default_value(1), "gpu threads")
+        ("cpu-threads,c", po::value<int>()->default_value(0), "worker threads shared by stepping, rendering and encoding, 0 uses every hardware thread")
+        ("rule", po::value<std::string>()->default_value("B3/S23"), "life-like rule, e.g. B36/S23, or Generations rule, e.g. B2/S/C3")
+        ("gps", po::value<double>()->default_value(15), "target generations per second")
+        ("fps", po::value<double>()->default_value(60), "target frames per second")
+        ("out-of-core", po::value<std::string>(), "step a file-backed world without a window")
+        ("strip-rows", po::value<int>()->default_value(0), "rows per strip in out-of-core mode, 0 picks ~64MB strips")
+        ("ranks", po::value<int>(), "split the torus over this many processes, without a window")
+        ("rank", po::value<int>(), "run only this rank of a --ranks run")
+        ("transport", po::value<std::string>()->default_value("shm"), "halo transport between ranks: shm, unix or tcp")
+        ("session", po::value<std::string>(), "name shared by the ranks of one run")
+        ("port", po::value<int>()->default_value(47000), "first tcp port, rank r listens on port+r")
+        ("halo", po::value<int>()->default_value(1), "halo width k, ranks exchange every k generations")
+        ("kernel", po::value<std::string>()->default_value("auto"), "two-state kernel: auto, table or block (2x2 cells per lookup)")
+        ("bench-kernels", "time every kernel on a random board of the given size and rule, without a window")
+        ("trace", po::value<std::string>(), "record pool tasks and phases, written as Chrome trace-event JSON to this file on exit")
+        ("profile", "count instructions, cycles, cache misses and branch misses per cell while stepping, rendering and encoding")
+        ("boundary", po::value<std::string>()->default_value("torus"), "edges of the board: torus, dead, cylinder (wraps left to right) or klein (also wraps top to bottom, mirrored)")
+        ("history", po::value<int>()->default_value(64), "megabytes of past generations kept for stepping back with B, 0 keeps none; nothing is kept with --generations")
+        ("paste", po::value<std::string>(), "pattern file pasted at the mouse cursor with V, a glider by default")
+        ("partitions", po::value<std::string>()->default_value("adaptive"), "worker partitions: adaptive (sized from measured step times) or even")
+        ("pin", "bind each cpu worker to its own core")
+        ("numa", "pin workers and keep the part of the grid each one steps on its node")
+        ("huge-pages", "ask for transparent huge pages for the grid")
+        ("seed", po::value<uint64_t>(), "seed for random boards, the same seed gives the same boards")
+        ("density", po::value<int>()->default_value(17), "percent of cells alive on random boards")
+        ("soups", po::value<uint64_t>(), "run this many random soups without a window and report how they end")
+        ("soup-board", po::value<int>()->default_value(64), "side of the torus each soup runs on")
+        ("soup-size", po::value<int>()->default_value(16), "side of the random square each soup starts from")
+        ("soup-density", po::value<int>()->default_value(50), "percent of the soup square alive at the start")
+        ("soup-cap", po::value<int>()->default_value(10000), "give up on a soup after this many generations")
+        ("census", "count the still lifes, oscillators and spaceships the soups leave behind")
+        ("checkpoint-every", po::value<int>()->default_value(0), "write a snapshot in the background every N generations")
+        ("checkpoint-keep", po::value<int>()->default_value(3), "number of snapshots to retain, 0 keeps all")
+        ("checkpoint-dir", po::value<std::string>()->default_value("."), "directory for snapshots")
     ;
 
     po::variables_map vm;
@@ -348,6 +958,37 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    rule life_rule;
+    try {
+        life_rule = rule::parse(vm["rule"].as<std::string>());
+    }
+    catch(const std::invalid_argument &e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if (vm["boundary"].as<std::string>() != "torus" &&
+        (vm.count("out-of-core") || vm.count("ranks") || vm.count("soups"))) {
+        cerr << "--out-of-core, --ranks and --soups only run on a torus\n";
+        return 1;
+    }
+
+    if (vm.count("out-of-core")) {
+        return run_out_of_core(vm, life_rule);
+    }
+
+    if (vm.count("ranks")) {
+        return run_distributed(vm, life_rule);
+    }
+
+    if (vm.count("soups")) {
+        return run_soup_search(vm, life_rule);
+    }
+
+    if (vm.count("bench-kernels")) {
+        return run_kernel_bench(vm, life_rule);
+    }
+
     SDL_Init(SDL_INIT_VIDEO);
     TTF_Init();
 
@@ -357,22 +998,88 @@ int main(int argc, char **argv) {
             vm["scale"].as<int>(),
             (bool) vm.count("gif"),
             (bool) vm.count("stdout"),
-            vm["cpu-threads"].as<int>(),
-            vm["gpu-threads"].as<int>()
+            worker_threads(vm)
     );
 
+    if (vm.count("seed") || !vm["density"].defaulted()) {
+        window.w.set_seed(vm.count("seed") ? vm["seed"].as<uint64_t>() : random_seed(), vm["density"].as<int>());
+        window.w.seed_life();
+    }
+
     if (vm.count("filename")) {
         std::string filename = vm["filename"].as<std::string>();
-        if(boost::algorithm::ends_with(filename, ".gol")) {
-            window.w.load_generation(filename);
+        try {
+            window.w.load_generation(filename, boost::algorithm::ends_with(filename, ".gol"));
         }
-        else {
-            window.w.load_generation(filename, false);
+        catch(const std::runtime_error &e) {
+            cerr << e.what() << "\n";
+            return 1;
         }
     }
 
+    window.w.set_rule(life_rule);
+    try {
+        window.w.set_boundary(vm["boundary"].as<std::string>());
+        window.w.set_kernel(vm["kernel"].as<std::string>());
+        window.w.set_partitioning(vm["partitions"].as<std::string>());
+    }
+    catch(const std::invalid_argument &e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    if (vm.count("pin") || vm.count("numa")) {
+        window.w.pin_workers();
+    }
+    // with --numa the columns are reallocated on their node and get huge
+    // pages there
+    window.w.huge_pages = (bool) vm.count("huge-pages");
+    if (window.w.huge_pages) {
+        window.w.advise_huge_pages();
+    }
+    if (vm.count("numa")) {
+        window.w.numa_placement = true;
+        window.w.place_partitions();
+        cerr << window.w.numa_report() << "\n";
+    }
+    if (vm.count("paste")) {
+        try {
+            window.clipboard = std::make_shared<brush>(brush::load(vm["paste"].as<std::string>()));
+        }
+        catch(const std::runtime_error &e) {
+            cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (vm["history"].as<int>() < 0) {
+        cerr << "--history must not be negative\n";
+        return 1;
+    }
+    // a run to --generations quits when it gets there, so nobody could
+    // step back and recording would only slow it down
+    if (!vm.count("generations")) {
+        window.w.rewind.budget = (size_t)vm["history"].as<int>() << 20;
+    }
+    window.w.checkpoint_every = vm["checkpoint-every"].as<int>();
+    window.w.checkpoints.keep = vm["checkpoint-keep"].as<int>();
+    window.w.checkpoint_dir = vm["checkpoint-dir"].as<std::string>();
+    if (vm.count("profile")) {
+        window.profile.reset(new perf_profile());
+        if (!window.profile->available()) {
+            cerr << "profile: perf counters unavailable (" << window.profile->error << ")\n";
+        }
+    }
+    if (vm.count("trace")) {
+        window.trace.reset(new tracer());
+        window.trace_file = vm["trace"].as<std::string>();
+        window.trace->label_thread("main");
+        tracer::active = window.trace.get();
+    }
+    window.scheduler.set_gps(vm["gps"].as<double>());
+    window.scheduler.set_fps(vm["fps"].as<double>());
+
     if (vm.count("generations")) {
         window.generations = vm["generations"].as<int>();
+        window.w.target_generation = window.generations;
         window.evolution = true;
     }
 
@@ -0,0 +1,52 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+namespace {
+  std::runtime_error sys_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+  }
+}
+
+mapped_file::mapped_file(const std::string &path)
+  : data(nullptr),
+    size(0)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) throw sys_error("cannot open", path);
+
+  struct stat st;
+  if(fstat(fd, &st) != 0) {
+    auto const e = sys_error("cannot stat", path);
+    ::close(fd);
+    throw e;
+  }
+  size = (size_t)st.st_size;
+  if(size == 0) {
+    ::close(fd);
+    return;
+  }
+
+  void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  if(m == MAP_FAILED) {
+    auto const e = sys_error("cannot map", path);
+    ::close(fd);
+    throw e;
+  }
+  // the mapping keeps the file open
+  ::close(fd);
+  data = (const char*)m;
+  // every part is read once, by some worker; start reading all of it
+  madvise(m, size, MADV_WILLNEED);
+}
+
+mapped_file::~mapped_file() {
+  if(data) munmap((void*)data, size);
+}
@@ -0,0 +1,23 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// A whole file mapped read-only, so workers can parse parts of it in
+// parallel straight from the page cache. Throws std::runtime_error when
+// the file cannot be opened or mapped. An empty file maps to no data.
+class mapped_file
+{
+public:
+  const char *data;
+  size_t size;
+
+public:
+  explicit mapped_file(const std::string &path);
+  ~mapped_file();
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/range/irange.hpp>
+#include <boost/range/algorithm/for_each.hpp>
+
+#include "mapped_world.hpp"
+#include "bitrow.hpp"
+#include "random.hpp"
+
+namespace {
+  const char magic[8] = {'G','O','L','M','A','P','1','\0'};
+  const size_t page = 4096;
+
+  size_t page_down(size_t v) { return v & ~(page-1); }
+  size_t page_up(size_t v) { return (v + page-1) & ~(page-1); }
+
+  std::runtime_error sys_error(const std::string &what, const std::string &path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+  }
+}
+
+mapped_world::mapped_world(const std::string &path, const int64_t &width, const int64_t &height,
+                           const int &threads, const int64_t &strip)
+  : width(width),
+    height(height),
+    words(bitrow::words_for((int)width)),
+    population(0),
+    io_wait_seconds(0),
+    created(false),
+    pool(threads),
+    fd(-1),
+    map(nullptr)
+{
+  if(width < 1 || height < 3 || width > (int64_t)1 << 30) {
+    throw std::invalid_argument("out-of-core world must be at least 1x3 and at most 2^30 cells wide");
+  }
+
+  grid_offset = page_up(sizeof(header));
+  grid_bytes = page_up((size_t)height*words*sizeof(uint64_t));
+  map_size = grid_offset + 2*grid_bytes;
+
+  // aim for strips of about 64MB unless told otherwise
+  const int64_t row_bytes = (int64_t)words*sizeof(uint64_t);
+  strip_rows = strip > 0 ? strip : std::max<int64_t>(1, ((int64_t)64 << 20)/row_bytes);
+  strip_rows = std::min(strip_rows, height);
+
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd < 0) throw sys_error("cannot open", path);
+  // the destructor doesn't run when the constructor throws
+  auto fail = [this, &path] (const std::string &what) {
+    auto const error = sys_error(what, path);
+    ::close(fd);
+    fd = -1;
+    return error;
+  };
+
+  struct stat st;
+  if(fstat(fd, &st) != 0) throw fail("cannot stat");
+  if((size_t)st.st_size != map_size) {
+    // sparse file, untouched pages read back as dead cells
+    if(ftruncate(fd, 0) != 0 || ftruncate(fd, map_size) != 0) throw fail("cannot resize");
+    created = true;
+  }
+
+  void *m = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(m == MAP_FAILED) throw fail("cannot map");
+  map = (uint8_t*)m;
+  madvise(map, map_size, MADV_SEQUENTIAL);
+
+  head = (header*)map;
+  if(!created && (std::memcmp(head->magic, magic, sizeof(magic)) != 0 ||
+                  head->width != (uint64_t)width || head->height != (uint64_t)height)) {
+    munmap(map, map_size);
+    ::close(fd);
+    throw std::runtime_error(path + " is not a " + std::to_string(width) + "x" +
+                             std::to_string(height) + " out-of-core world");
+  }
+  if(created) {
+    std::memcpy(head->magic, magic, sizeof(magic));
+    head->width = width;
+    head->height = height;
+    head->generation = 0;
+    head->current = 0;
+    head->birth = rules::conway.birth;
+    head->survive = rules::conway.survive;
+  }
+  life_rule = rule{(unsigned)head->birth, (unsigned)head->survive};
+}
+
+mapped_world::~mapped_world() {
+  if(prefetched.valid()) prefetched.wait();
+  if(map) {
+    msync(map, grid_offset, MS_SYNC);
+    munmap(map, map_size);
+  }
+  if(fd >= 0) ::close(fd);
+}
+
+uint64_t *mapped_world::grid(const uint64_t &which) const {
+  return (uint64_t*)(map + grid_offset + which*grid_bytes);
+}
+
+uint64_t *mapped_world::row(const uint64_t &which, const int64_t &y) const {
+  return grid(which) + (size_t)y*words;
+}
+
+void mapped_world::set_rule(const rule &r) {
+  life_rule = r;
+  head->birth = r.birth;
+  head->survive = r.survive;
+}
+
+// asks the kernel to read rows ahead and touches them, so the next strip
+// is paged in while the current one is being computed
+void mapped_world::prefetch(const uint64_t &which, int64_t from_y, int64_t to_y) {
+  from_y = std::max<int64_t>(0, from_y);
+  to_y = std::min(height, to_y);
+  if(from_y >= to_y) return;
+  const size_t begin = page_down((uint8_t*)row(which, from_y) - map);
+  const size_t end = (uint8_t*)row(which, to_y) - map;
+  madvise(map + begin, end - begin, MADV_WILLNEED);
+  volatile uint8_t sink = 0;
+  for(size_t offset = begin; offset < end; offset += page) sink ^= map[offset];
+  (void)sink;
+}
+
+// drops rows from memory once a strip is done with them; written rows are
+// pushed to disk first so the page cache can let go of them
+void mapped_world::release(const uint64_t &which, int64_t from_y, int64_t to_y, const bool &written) {
+  from_y = std::max<int64_t>(0, from_y);
+  to_y = std::min(height, to_y);
+  if(from_y >= to_y) return;
+  // only whole pages that belong to these rows
+  const size_t begin = page_up((uint8_t*)row(which, from_y) - map);
+  const size_t end = page_down((uint8_t*)row(which, to_y) - map);
+  if(begin >= end) return;
+  if(written) msync(map + begin, end - begin, MS_SYNC);
+  madvise(map + begin, end - begin, MADV_DONTNEED);
+  posix_fadvise(fd, begin, end - begin, POSIX_FADV_DONTNEED);
+}
+
+void mapped_world::seed_life(const uint64_t &seed, const int &percent) {
+  const bulk_random bulk(bulk_random::board_seed(seed, 0), percent);
+  const uint64_t tail = bitrow::tail_mask((int)width);
+  const int workers = (int)pool.workers.size();
+  for(int64_t y0 = 0; y0 < height; y0 += strip_rows) {
+    const int64_t y1 = std::min(height, y0+strip_rows);
+    const int64_t load = (y1 - y0 + workers - 1)/workers;
+    boost::for_each(boost::irange(0, workers), [&] (int worker) {
+      const int64_t from = std::min(y1, y0 + worker*load);
+      const int64_t to = std::min(y1, from+load);
+      results.emplace_back(pool.enqueue([this, from, to, tail, &bulk] {
+        for(int64_t y = from; y < to; y++) {
+          uint64_t *r = row(head->current, y);
+          const uint64_t stream = bulk.stream(y);
+          for(int i = 0; i < words; i++) r[i] = bulk.cells(stream, i);
+          r[words-1] &= tail;
+        }
+      }));
+    });
+    boost::for_each(results, [] (auto &t) { t.wait(); });
+    results.clear();
+    release(head->current, y0, y1, true);
+  }
+  head->generation = 0;
+}
+
+void mapped_world::next_generation() {
+  typedef std::chrono::steady_clock clock;
+  const uint64_t src = head->current, dst = 1 - head->current;
+  const bitrow::rule_counts counts(life_rule);
+  const int workers = (int)pool.workers.size();
+  std::vector<uint64_t> worker_population(workers, 0);
+
+  // the wrap-around halo rows are needed by the first and the last strip
+  prefetch(src, height-1, height);
+  prefetch(src, 0, std::min(height, strip_rows+1));
+
+  for(int64_t y0 = 0; y0 < height; y0 += strip_rows) {
+    const int64_t y1 = std::min(height, y0+strip_rows);
+
+    auto const wait_start = clock::now();
+    if(prefetched.valid()) prefetched.wait();
+    io_wait_seconds += std::chrono::duration<double>(clock::now() - wait_start).count();
+
+    if(y1 < height) {
+      prefetched = std::async(std::launch::async, [this, src, y1] {
+        prefetch(src, y1, y1+strip_rows+1);
+      });
+    }
+
+    const int64_t load = (y1 - y0 + workers - 1)/workers;
+    boost::for_each(boost::irange(0, workers), [&] (int worker) {
+      const int64_t from = std::min(y1, y0 + worker*load);
+      const int64_t to = std::min(y1, from+load);
+      results.emplace_back(pool.enqueue([this, from, to, src, dst, worker, &counts, &worker_population] {
+        std::vector<uint64_t> scratch(6*(size_t)words);
+        uint64_t live = 0;
+        for(int64_t y = from; y < to; y++) {
+          uint64_t *out = row(dst, y);
+          bitrow::life_row(row(src, (y+height-1) % height), row(src, y), row(src, (y+1) % height),
+                           out, words, (int)width, counts, scratch.data());
+          for(int i = 0; i < words; i++) live += __builtin_popcountll(out[i]);
+        }
+        worker_population[worker] += live;
+      }));
+    });
+    boost::for_each(results, [] (auto &t) { t.wait(); });
+    results.clear();
+
+    // rows y0-1 and y1 are still the halo of the neighbouring strips
+    release(src, y0 == 0 ? 1 : y0-1, y1-1, false);
+    release(dst, y0, y1, true);
+  }
+  if(prefetched.valid()) prefetched.wait();
+
+  population = 0;
+  for(auto live : worker_population) population += live;
+  head->current = dst;
+  head->generation++;
+}
+
+void mapped_world::flush() {
+  msync(map, map_size, MS_SYNC);
+}
@@ -0,0 +1,72 @@
+#ifndef MAPPED_WORLD_HPP
+#define MAPPED_WORLD_HPP
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "rule.hpp"
+
+// Out-of-core world for boards larger than RAM. The file holds a header
+// and two bit-packed grids (current and next generation) and is mapped
+// into memory. A generation is stepped in horizontal strips: while one
+// strip is computed the next one is prefetched, and strips that are done
+// are written back and dropped from the page cache, so only about a
+// strip plus its halo rows is resident at a time.
+class mapped_world
+{
+public:
+  struct header {
+    char magic[8];
+    uint64_t width;
+    uint64_t height;
+    uint64_t generation;
+    uint64_t current;
+    uint64_t birth;
+    uint64_t survive;
+  };
+
+  int64_t width;
+  int64_t height;
+  int words;
+  int64_t strip_rows;
+  rule life_rule;
+  uint64_t population;
+  double io_wait_seconds;
+  // true when the file was new or had the wrong size and got cleared
+  bool created;
+  ThreadPool pool;
+  std::vector< std::future<void> > results;
+
+private:
+  int fd;
+  uint8_t *map;
+  size_t map_size;
+  size_t grid_offset;
+  size_t grid_bytes;
+  header *head;
+  std::future<void> prefetched;
+
+  uint64_t *grid(const uint64_t &which) const;
+  uint64_t *row(const uint64_t &which, const int64_t &y) const;
+  void prefetch(const uint64_t &which, int64_t from_y, int64_t to_y);
+  void release(const uint64_t &which, int64_t from_y, int64_t to_y, const bool &written);
+
+public:
+  // opens path, creating or resizing it when its size doesn't match
+  mapped_world(const std::string &path, const int64_t &width, const int64_t &height,
+               const int &threads = 1, const int64_t &strip_rows = 0);
+  ~mapped_world();
+
+  uint64_t generation() const { return head->generation; }
+  uint64_t *row(const int64_t &y) const { return row(head->current, y); }
+
+  void set_rule(const rule &r);
+  void seed_life(const uint64_t &seed, const int &percent = 17);
+  void next_generation();
+  void flush();
+};
+
+#endif // MAPPED_WORLD_HPP
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "numa.hpp"
+
+namespace {
+  const size_t huge_page = 2 << 20;
+
+  // "0-3,8-11" style lists from sysfs
+  std::vector<int> parse_list(const std::string &list) {
+    std::vector<int> ids;
+    size_t pos = 0;
+    while(pos < list.size()) {
+      size_t end = list.find(',', pos);
+      if(end == std::string::npos) end = list.size();
+      auto const range = list.substr(pos, end-pos);
+      auto const dash = range.find('-');
+      try {
+        const int from = std::stoi(range.substr(0, dash));
+        const int to = dash == std::string::npos ? from : std::stoi(range.substr(dash+1));
+        for(int id = from; id <= to; id++) ids.push_back(id);
+      }
+      catch(const std::exception &) {}
+      pos = end+1;
+    }
+    return ids;
+  }
+
+  size_t page_size() {
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+    return size;
+  }
+}
+
+std::vector<numa::cpu> numa::online_cpus() {
+  std::vector<cpu> cpus;
+  std::string line;
+  std::ifstream online("/sys/devices/system/cpu/online");
+  if(!std::getline(online, line)) {
+    const int n = (int)std::max(1u, std::thread::hardware_concurrency());
+    for(int id = 0; id < n; id++) cpus.push_back(cpu{id, 0});
+    return cpus;
+  }
+  for(auto id : parse_list(line)) cpus.push_back(cpu{id, 0});
+
+  if(DIR *dir = opendir("/sys/devices/system/node")) {
+    while(dirent *entry = readdir(dir)) {
+      int node;
+      if(std::sscanf(entry->d_name, "node%d", &node) != 1) continue;
+      std::ifstream list(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+      if(!std::getline(list, line)) continue;
+      for(auto id : parse_list(line)) {
+        for(auto &c : cpus) {
+          if(c.id == id) c.node = node;
+        }
+      }
+    }
+    closedir(dir);
+  }
+  std::stable_sort(cpus.begin(), cpus.end(), [](const cpu &a, const cpu &b) { return a.node < b.node; });
+  return cpus;
+}
+
+int numa::node_count() {
+  int nodes = 0;
+  for(auto const &c : online_cpus()) nodes = std::max(nodes, c.node+1);
+  return nodes;
+}
+
+bool numa::pin(std::thread &t, const int &cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+}
+
+void numa::touch_here(void *p, const size_t &n) {
+  const uintptr_t ps = page_size();
+  const uintptr_t from = ((uintptr_t)p + ps-1) & ~(ps-1);
+  const uintptr_t to = ((uintptr_t)p + n) & ~(ps-1);
+  if(from >= to) return;
+  std::vector<char> copy((char *)from, (char *)to);
+  if(madvise((void *)from, to-from, MADV_DONTNEED) != 0) return;
+  std::memcpy((void *)from, copy.data(), copy.size());
+}
+
+void numa::advise_huge(void *p, const size_t &n) {
+#ifdef MADV_HUGEPAGE
+  const uintptr_t from = ((uintptr_t)p + huge_page-1) & ~(uintptr_t)(huge_page-1);
+  const uintptr_t to = ((uintptr_t)p + n) & ~(uintptr_t)(huge_page-1);
+  if(from < to) madvise((void *)from, to-from, MADV_HUGEPAGE);
+#else
+  (void)p; (void)n; (void)huge_page;
+#endif
+}
+
+bool numa::page_nodes(const void *p, const size_t &n, std::vector<int> &nodes) {
+  const uintptr_t ps = page_size();
+  const uintptr_t from = (uintptr_t)p & ~(ps-1);
+  const uintptr_t to = ((uintptr_t)p + n + ps-1) & ~(ps-1);
+  std::vector<void *> pages;
+  for(uintptr_t a = from; a < to; a += ps) pages.push_back((void *)a);
+  nodes.assign(pages.size(), -1);
+  if(pages.empty()) return true;
+#ifdef SYS_move_pages
+  // without target nodes move_pages only reports where each page is
+  return syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, nodes.data(), 0) == 0;
+#else
+  return false;
+#endif
+}
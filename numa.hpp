@@ -0,0 +1,36 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Thread placement and page placement without libnuma: the topology is
+// read from sysfs, threads are bound with sched affinity, and pages are
+// placed by the kernel's first-touch policy.
+namespace numa {
+  struct cpu {
+    int id;
+    int node;
+  };
+
+  // online cpus, grouped by node
+  std::vector<cpu> online_cpus();
+  int node_count();
+
+  // binds t to one cpu; false if the kernel refused
+  bool pin(std::thread &t, const int &cpu);
+
+  // Drops the whole pages of [p, p+n) and writes the data back from the
+  // calling thread, which moves them to its node. Only for private
+  // anonymous memory nobody else is using meanwhile.
+  void touch_here(void *p, const size_t &n);
+  // asks for transparent huge pages on the whole 2MB pages of [p, p+n)
+  void advise_huge(void *p, const size_t &n);
+
+  // node of every page of [p, p+n), -1 where unknown; false if the
+  // kernel can't tell
+  bool page_nodes(const void *p, const size_t &n, std::vector<int> &nodes);
+}
+
+#endif // NUMA_HPP
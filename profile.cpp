@@ -0,0 +1,140 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "profile.hpp"
+
+namespace {
+  const char *const names[] = {"instructions", "cycles", "cache-misses", "branch-misses", "task-clock-ns"};
+
+  const uint64_t configs[] = {
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_SW_TASK_CLOCK
+  };
+
+  int open_counter(const int &c, const pid_t &tid) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = c == perf_profile::task_clock ? PERF_TYPE_SOFTWARE : PERF_TYPE_HARDWARE;
+    attr.config = configs[c];
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // user space only, which is allowed at the default paranoid level
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+  }
+
+  std::vector<pid_t> threads() {
+    std::vector<pid_t> tids;
+    if(DIR *dir = opendir("/proc/self/task")) {
+      while(dirent *entry = readdir(dir)) {
+        if(entry->d_name[0] != '.') tids.push_back((pid_t)std::atoi(entry->d_name));
+      }
+      closedir(dir);
+    }
+    return tids;
+  }
+}
+
+perf_profile::perf_profile() {
+  auto const tids = threads();
+  fds.assign(tids.size()*counters, -1);
+  for(int c = 0; c < counters; c++) {
+    has[c] = !tids.empty();
+    for(size_t t = 0; t < tids.size() && has[c]; t++) {
+      fds[t*counters + c] = open_counter(c, tids[t]);
+      if(fds[t*counters + c] >= 0) continue;
+      error += (error.empty() ? "" : ", ") + std::string(names[c]) + ": " + std::strerror(errno);
+      has[c] = false;
+    }
+    if(!has[c]) {
+      for(size_t t = 0; t < tids.size(); t++) {
+        if(fds[t*counters + c] >= 0) close(fds[t*counters + c]);
+        fds[t*counters + c] = -1;
+      }
+    }
+    started[c] = 0;
+  }
+}
+
+perf_profile::~perf_profile() {
+  for(auto fd : fds) {
+    if(fd >= 0) close(fd);
+  }
+}
+
+bool perf_profile::available() const {
+  for(int c = 0; c < counters; c++) {
+    if(has[c]) return true;
+  }
+  return false;
+}
+
+// summed over threads, scaled up when the kernel had to multiplex
+uint64_t perf_profile::read(const int &c) const {
+  uint64_t sum = 0;
+  for(size_t i = c; i < fds.size(); i += counters) {
+    uint64_t v[3];
+    if(fds[i] < 0 || ::read(fds[i], v, sizeof(v)) != sizeof(v)) continue;
+    sum += v[2] && v[2] < v[1] ? (uint64_t)((double)v[0]*v[1]/v[2]) : v[0];
+  }
+  return sum;
+}
+
+void perf_profile::begin() {
+  for(int c = 0; c < counters; c++) {
+    if(has[c]) started[c] = read(c);
+  }
+}
+
+void perf_profile::end(const std::string &phase, const double &cells) {
+  auto it = phases.begin();
+  while(it != phases.end() && it->first != phase) ++it;
+  if(it == phases.end()) {
+    phases.emplace_back(phase, totals{{0}, 0, 0});
+    it = phases.end()-1;
+  }
+  for(int c = 0; c < counters; c++) {
+    if(has[c]) it->second.value[c] += read(c) - started[c];
+  }
+  it->second.cells += cells;
+  it->second.samples++;
+}
+
+void perf_profile::report(std::ostream &out) const {
+  if(!available()) {
+    out << "profile: perf counters unavailable (" << error << ")\n";
+    return;
+  }
+  // keep the caller's formatting
+  std::ios format(nullptr);
+  format.copyfmt(out);
+  out << std::setprecision(3) << "profile, per cell:\n";
+  for(auto const &phase : phases) {
+    auto const &t = phase.second;
+    if(t.cells <= 0) continue;
+    out << "  " << std::left << std::setw(8) << phase.first << std::right
+        << " samples " << t.samples;
+    for(int c = 0; c < counters; c++) {
+      out << " " << names[c] << " ";
+      if(has[c]) out << t.value[c]/t.cells;
+      else out << "n/a";
+    }
+    if(has[instructions] && has[cycles] && t.value[cycles]) {
+      out << " ipc " << (double)t.value[instructions]/t.value[cycles];
+    }
+    out << "\n";
+  }
+  if(!error.empty()) out << "  unavailable: " << error << "\n";
+  out.copyfmt(format);
+}
@@ -0,0 +1,55 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Hardware counters around the phases of a frame, read with
+// perf_event_open. Every thread of the process gets its own counters,
+// which are summed, so work done by the pool's workers is included.
+// Counters the kernel refuses are reported as unavailable and the rest
+// keep working; with none at all the profile only notes why.
+// Counters are per cell of each phase, task-clock in nanoseconds summed
+// over threads.
+class perf_profile
+{
+public:
+  // task-clock is a software counter, so it usually survives where the
+  // hardware ones are missing, e.g. in virtual machines
+  enum counter { instructions, cycles, cache_misses, branch_misses, task_clock, counters };
+
+  struct totals {
+    uint64_t value[counters];
+    // cells times generations, or cells times frames
+    double cells;
+    uint64_t samples;
+  };
+
+private:
+  // fds[thread*counters + counter], -1 where unavailable
+  std::vector<int> fds;
+  bool has[counters];
+  uint64_t started[counters];
+  std::vector< std::pair<std::string, totals> > phases;
+
+  uint64_t read(const int &c) const;
+
+public:
+  std::string error;
+
+public:
+  // call once all long-lived threads are running
+  perf_profile();
+  ~perf_profile();
+
+  bool available() const;
+  void begin();
+  // charges the counts since begin() to phase, over this many cell updates
+  void end(const std::string &phase, const double &cells);
+  void report(std::ostream &out) const;
+};
+
+#endif // PROFILE_HPP
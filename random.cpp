@@ -10,3 +10,35 @@ random_gen::random_gen(int from, int to)
 int random_gen::get() {
     return uniform_dist(e);
 }
+
+bulk_random::bulk_random(const uint64_t &seed, const int &percent)
+        : seed(seed),
+          density((percent*256 + 50)/100)
+{ }
+
+// the splitmix64 finalizer
+uint64_t bulk_random::mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Builds the density bit by bit from the least significant end: a set bit
+// ORs in a uniform word, a clear one ANDs it, giving density/256 exactly.
+// Clear bits below the lowest set one would only AND zeros.
+uint64_t bulk_random::cells(const uint64_t &stream, const uint64_t &counter) const {
+    if(density <= 0) return 0;
+    if(density >= 256) return ~uint64_t(0);
+    uint64_t v = 0;
+    const uint64_t base = stream + counter*8*0xD1B54A32D192ED03ull;
+    for(int bit = __builtin_ctz(density); bit < 8; bit++) {
+        const uint64_t r = mix(base + (uint64_t)bit*0xD1B54A32D192ED03ull);
+        v = (density >> bit) & 1 ? v | r : v & r;
+    }
+    return v;
+}
+
+uint64_t random_seed() {
+    std::random_device rd;
+    return (uint64_t)rd() << 32 | rd();
+}
@@ -1,6 +1,7 @@
 #ifndef RANDOM_HPP
 #define RANDOM_HPP
 
+#include <cstdint>
 #include <random>
 
 class random_gen {
@@ -12,4 +13,29 @@ public:
     int get();
 };
 
-#endif //RANDOM_HPP
\ No newline at end of file
+// Counter-based generator for seeding boards 64 cells at a time. Every
+// word is a pure function of (seed, stream, counter), so tiles can be
+// filled in any order by any number of threads with the same result.
+// Boards use the row as stream and the 64-cell word of the row as counter.
+class bulk_random {
+    uint64_t seed;
+    // probability of a live cell in 1/256
+    int density;
+public:
+    bulk_random(const uint64_t &seed, const int &percent);
+    static uint64_t mix(uint64_t x);
+    // Seed of board number reseed of a run: the run's seed itself for the
+    // first board, so every mode draws the same first board from a seed,
+    // and a hash of both for the boards after it.
+    static uint64_t board_seed(const uint64_t &seed, const uint64_t &reseed) {
+        return reseed == 0 ? seed : mix(seed + reseed);
+    }
+    uint64_t stream(const uint64_t &id) const { return mix(seed + id*0x9E3779B97F4A7C15ull); }
+    // 64 cells, each alive with the configured density
+    uint64_t cells(const uint64_t &stream, const uint64_t &counter) const;
+};
+
+// a fresh seed from std::random_device, for runs without --seed
+uint64_t random_seed();
+
+#endif //RANDOM_HPP
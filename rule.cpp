@@ -0,0 +1,86 @@
+#include <cctype>
+#include <stdexcept>
+#include <vector>
+
+#include "rule.hpp"
+
+namespace {
+  unsigned parse_counts(const std::string &digits, const std::string &rulestring) {
+    unsigned mask = 0;
+    for(auto c : digits) {
+      if(c < '0' || c > '8') {
+        throw std::invalid_argument("invalid neighbour count '" + std::string(1, c) + "' in rule " + rulestring);
+      }
+      mask |= 1u << (c - '0');
+    }
+    return mask;
+  }
+
+  const char *const usage = "rule must look like B3/S23 or B2/S/C3: ";
+
+  int parse_states(std::string digits, const std::string &rulestring) {
+    if(!digits.empty() && (digits[0] == 'C' || digits[0] == 'G')) digits.erase(0, 1);
+    if(digits.empty() || digits.size() > 3 ||
+       digits.find_first_not_of("0123456789") != std::string::npos) {
+      throw std::invalid_argument(usage + rulestring);
+    }
+    int states = std::stoi(digits);
+    if(states < 2 || states > 256) {
+      throw std::invalid_argument("number of states must be between 2 and 256 in rule " + rulestring);
+    }
+    return states;
+  }
+}
+
+rule rule::parse(const std::string &rulestring) {
+  std::string s;
+  for(auto c : rulestring) {
+    if(!std::isspace((unsigned char)c)) s += (char)std::toupper((unsigned char)c);
+  }
+
+  std::vector<std::string> parts;
+  std::string::size_type start = 0, slash;
+  while((slash = s.find('/', start)) != std::string::npos) {
+    parts.push_back(s.substr(start, slash-start));
+    start = slash+1;
+  }
+  parts.push_back(s.substr(start));
+  if(parts.size() < 2 || parts.size() > 3) {
+    throw std::invalid_argument(usage + rulestring);
+  }
+  std::string left = parts[0];
+  std::string right = parts[1];
+
+  rule r{0, 0};
+  if(!left.empty() && left[0] == 'B') {
+    if(right.empty() || right[0] != 'S') {
+      throw std::invalid_argument(usage + rulestring);
+    }
+    r.birth = parse_counts(left.substr(1), rulestring);
+    r.survive = parse_counts(right.substr(1), rulestring);
+  }
+  else if(!left.empty() && left[0] == 'S') {
+    if(right.empty() || right[0] != 'B') {
+      throw std::invalid_argument(usage + rulestring);
+    }
+    r.survive = parse_counts(left.substr(1), rulestring);
+    r.birth = parse_counts(right.substr(1), rulestring);
+  }
+  else {
+    r.survive = parse_counts(left, rulestring);
+    r.birth = parse_counts(right, rulestring);
+  }
+  if(parts.size() == 3) {
+    r.states = parse_states(parts[2], rulestring);
+  }
+  return r;
+}
+
+std::string rule::name() const {
+  std::string n = "B";
+  for(int i = 0; i <= 8; i++) if(birth & (1u << i)) n += (char)('0' + i);
+  n += "/S";
+  for(int i = 0; i <= 8; i++) if(survive & (1u << i)) n += (char)('0' + i);
+  if(states > 2) n += "/C" + std::to_string(states);
+  return n;
+}
@@ -0,0 +1,38 @@
+#ifndef RULE_HPP
+#define RULE_HPP
+
+#include <string>
+
+// Outer-totalistic life-like rule. Bit n of birth/survive is set when a
+// dead/live cell with n live neighbours is alive in the next generation.
+// With more than two states it is a "Generations" rule: a live cell that
+// does not survive decays through states 2..states-1 before dying, and
+// only state 1 counts as a live neighbour.
+struct rule {
+  unsigned birth;
+  unsigned survive;
+  int states = 2;
+
+  // accepts "B36/S23" and "B2/S/C3" as well as the older "23/36" S/B
+  // and "/2/3" S/B/C notations
+  static rule parse(const std::string &rulestring);
+  std::string name() const;
+
+  bool operator==(const rule &other) const {
+    return birth == other.birth && survive == other.survive && states == other.states;
+  }
+  bool operator!=(const rule &other) const { return !(*this == other); }
+};
+
+namespace rules {
+  //                               876543210
+  constexpr rule conway          { 0b000001000, 0b000001100 }; // B3/S23
+  constexpr rule highlife        { 0b001001000, 0b000001100 }; // B36/S23
+  constexpr rule day_and_night   { 0b111001000, 0b111011000 }; // B3678/S34678
+  constexpr rule seeds           { 0b000000100, 0b000000000 }; // B2/S
+  constexpr rule life_without_death { 0b000001000, 0b111111111 }; // B3/S012345678
+  constexpr rule brians_brain    { 0b000000100, 0b000000000, 3 }; // B2/S/C3
+  constexpr rule star_wars       { 0b000000100, 0b000111000, 4 }; // B2/S345/C4
+}
+
+#endif // RULE_HPP
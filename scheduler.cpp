@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <thread>
+
+#include "scheduler.hpp"
+
+step_scheduler::step_scheduler(const double &gps, const double &fps)
+  : last_tick(clock::now()),
+    frame_start(last_tick),
+    deadline(last_tick),
+    stats_start(last_tick),
+    debt(0),
+    stepped(0),
+    stats_generations(0),
+    stats_frames(0),
+    target_gps(gps),
+    target_fps(fps),
+    achieved_gps(0),
+    achieved_fps(0)
+{ }
+
+void step_scheduler::begin_frame(const bool &running) {
+  frame_start = clock::now();
+  deadline = frame_start + std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(1.0/target_fps));
+  stepped = 0;
+
+  if(running) {
+    debt += std::chrono::duration<double>(frame_start - last_tick).count() * target_gps;
+  }
+  else {
+    debt = 0;
+  }
+  last_tick = frame_start;
+}
+
+bool step_scheduler::step_due() {
+  if(debt < 1) return false;
+
+  // always make progress, but leave the rest of the frame to rendering
+  if(stepped > 0 && clock::now() >= deadline) {
+    // drop what we could not keep up with instead of spiralling
+    debt = std::min(debt, target_gps/target_fps + 1);
+    return false;
+  }
+
+  debt -= 1;
+  stepped++;
+  stats_generations++;
+  return true;
+}
+
+bool step_scheduler::end_frame() {
+  stats_frames++;
+
+  // coarse sleep, then yield for the last stretch to hit the deadline
+  auto const slack = std::chrono::milliseconds(2);
+  auto now = clock::now();
+  if(deadline - now > slack) {
+    std::this_thread::sleep_until(deadline - slack);
+  }
+  while(clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+
+  now = clock::now();
+  auto const elapsed = std::chrono::duration<double>(now - stats_start).count();
+  if(elapsed < 0.5) return false;
+
+  achieved_gps = stats_generations/elapsed;
+  achieved_fps = stats_frames/elapsed;
+  stats_generations = 0;
+  stats_frames = 0;
+  stats_start = now;
+  return true;
+}
+
+void step_scheduler::set_gps(const double &gps) {
+  target_gps = std::max(gps, 0.1);
+}
+
+void step_scheduler::set_fps(const double &fps) {
+  target_fps = std::max(fps, 1.0);
+}
@@ -0,0 +1,42 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <chrono>
+
+// Fixed-timestep pacing for the main loop. Generations and frames have
+// independent target rates: at high generation rates several generations
+// run between two frames, at low rates the loop sleeps until the next
+// frame is due. Stepping never runs past the frame deadline, so a slow
+// kernel lowers the achieved generation rate instead of the frame rate.
+class step_scheduler
+{
+  typedef std::chrono::steady_clock clock;
+
+  clock::time_point last_tick;
+  clock::time_point frame_start;
+  clock::time_point deadline;
+  clock::time_point stats_start;
+  double debt;
+  int stepped;
+  unsigned long stats_generations;
+  unsigned long stats_frames;
+
+public:
+  double target_gps;
+  double target_fps;
+  double achieved_gps;
+  double achieved_fps;
+
+public:
+  step_scheduler(const double &gps = 15, const double &fps = 60);
+
+  void begin_frame(const bool &running);
+  bool step_due();
+  int generations_this_frame() const { return stepped; }
+  // returns true when the achieved rates were refreshed
+  bool end_frame();
+  void set_gps(const double &gps);
+  void set_fps(const double &fps);
+};
+
+#endif // SCHEDULER_HPP
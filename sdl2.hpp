@@ -0,0 +1,26 @@
+#ifndef SDL2_HPP
+#define SDL2_HPP
+
+#include <memory>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+struct SDL_Deleter {
+    void operator()(SDL_Window* w) const { SDL_DestroyWindow(w); }
+    void operator()(SDL_Renderer* r) const { SDL_DestroyRenderer(r); }
+    void operator()(SDL_Texture* t) const { SDL_DestroyTexture(t); }
+    void operator()(SDL_Surface* t) const { SDL_FreeSurface(t); }
+    void operator()(TTF_Font* t) const { TTF_CloseFont(t); }
+};
+
+namespace sdl2
+{
+    typedef std::unique_ptr<SDL_Window, SDL_Deleter> window_ptr_t;
+    typedef std::unique_ptr<SDL_Renderer, SDL_Deleter> renderer_ptr_t;
+    typedef std::unique_ptr<SDL_Texture, SDL_Deleter> texture_ptr_t;
+    typedef std::unique_ptr<SDL_Surface, SDL_Deleter> surface_ptr_t;
+    typedef std::unique_ptr<TTF_Font, SDL_Deleter> font_ptr_t;
+}
+
+#endif //SDL2_HPP
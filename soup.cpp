@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <sstream>
+
+#include "soup.hpp"
+#include "census.hpp"
+#include "random.hpp"
+#include "ThreadPool.h"
+
+namespace {
+  int log2_bucket(const int &n) {
+    int b = 0;
+    while((1 << (b+1)) <= n) b++;
+    return b;
+  }
+}
+
+soup_board::soup_board(const int &width, const int &height, const int &cap, const rule &r)
+  : epoch(0),
+    width(width),
+    height(height),
+    words(bitrow::words_for(width)),
+    counts(r)
+{
+  cur.assign((size_t)height*words, 0);
+  next = cur;
+  scratch.resize(6*(size_t)words);
+  size_t slots = 1;
+  while(slots < 2*(size_t)cap + 2) slots <<= 1;
+  table.assign(slots, seen{0, 0, 0});
+}
+
+void soup_board::seed(const uint64_t &seed, const uint64_t &index, const int &size, const int &percent) {
+  std::fill(cur.begin(), cur.end(), 0);
+  const bulk_random bulk(bulk_random::mix(seed + index), percent);
+  const int x0 = (width-size)/2, y0 = (height-size)/2;
+  for(int y = 0; y < size; y++) {
+    const uint64_t stream = bulk.stream(y);
+    for(int x = 0; x < size; x += 64) {
+      bitrow::set_bits(row(cur, y0+y), x0+x, std::min(64, size-x), bulk.cells(stream, x/64));
+    }
+  }
+}
+
+void soup_board::step() {
+  for(int y = 0; y < height; y++) {
+    const int above = (y+height-1) % height, below = (y+1) % height;
+    bitrow::life_row(&cur[(size_t)above*words], &cur[(size_t)y*words], &cur[(size_t)below*words],
+                     row(next, y), words, width, counts, scratch.data());
+  }
+  cur.swap(next);
+}
+
+uint64_t soup_board::hash() const {
+  uint64_t h = 0x84222325CBF29CE4ull;
+  for(auto w : cur) {
+    h = (h ^ w) * 0x100000001B3ull;
+    h ^= h >> 29;
+  }
+  return h;
+}
+
+uint64_t soup_board::population() const {
+  uint64_t live = 0;
+  for(auto w : cur) live += __builtin_popcountll(w);
+  return live;
+}
+
+soup_result soup_board::run(const uint64_t &index, const int &cap) {
+  epoch++;
+  const size_t mask = table.size()-1;
+  for(int generation = 0; generation <= cap; generation++) {
+    const uint64_t h = hash();
+    size_t slot = h & mask;
+    while(table[slot].epoch == epoch) {
+      if(table[slot].hash == h) {
+        const int first = table[slot].generation;
+        return soup_result{index, first, generation-first, population()};
+      }
+      slot = (slot+1) & mask;
+    }
+    table[slot] = seen{h, epoch, generation};
+    if(generation < cap) step();
+  }
+  return soup_result{index, cap, 0, population()};
+}
+
+int run_soups(const soup_options &options, std::ostream &out, std::ostream &log) {
+  auto const threads = std::max(1, options.threads);
+  // enough soups per round to keep every worker busy between reports
+  const uint64_t round = 256*(uint64_t)threads;
+
+  ThreadPool pool(threads);
+  std::vector<soup_board> boards(threads, soup_board(options.board, options.board, options.cap, options.life_rule));
+  std::vector<soup_result> results(round);
+  census objects;
+  std::vector<census_worker> surveyors(threads, census_worker(objects, options.life_rule));
+  std::vector< std::future<void> > futures;
+
+  std::map<int, uint64_t> lifetimes;
+  std::map<int, uint64_t> periods;
+  uint64_t capped = 0;
+  double population = 0;
+
+  log << "soups " << options.soups << " seed " << options.seed << " board " << options.board
+      << " size " << options.size << " density " << options.percent << "% cap " << options.cap
+      << " threads " << threads << "\n";
+
+  auto const start = std::chrono::steady_clock::now();
+  for(uint64_t first = 0; first < options.soups; first += round) {
+    const uint64_t count = std::min(round, options.soups-first);
+    std::atomic<uint64_t> next(0);
+    for(int t = 0; t < threads; t++) {
+      futures.emplace_back(pool.enqueue([&, t] {
+        auto &board = boards[t];
+        for(uint64_t i; (i = next.fetch_add(1)) < count;) {
+          board.seed(options.seed, first+i, options.size, options.percent);
+          results[i] = board.run(first+i, options.cap);
+          if(options.census && results[i].period) surveyors[t].survey(board, results[i].period);
+        }
+      }));
+    }
+    for(auto &f : futures) f.get();
+    futures.clear();
+
+    std::ostringstream lines;
+    for(uint64_t i = 0; i < count; i++) {
+      auto const &r = results[i];
+      lines << "soup " << r.index << " lifetime " << r.lifetime
+            << " period " << r.period << " population " << r.population << "\n";
+      lifetimes[log2_bucket(r.lifetime)]++;
+      if(r.period) periods[r.period]++;
+      else capped++;
+      population += r.population;
+    }
+    out << lines.str();
+
+    const uint64_t done = first+count;
+    auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log << "soups " << done << " " << (done/seconds) << " soups/s\n";
+  }
+  out.flush();
+
+  auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  log << "total " << options.soups << " soups in " << seconds << "s, "
+      << (options.soups/seconds) << " soups/s\n";
+  log << "mean final population " << (options.soups ? population/options.soups : 0) << "\n";
+  log << "capped at " << options.cap << " generations: " << capped << "\n";
+  log << "lifetimes:\n";
+  for(auto const &b : lifetimes) {
+    log << "  " << (b.first ? 1 << b.first : 0) << "-" << ((1 << (b.first+1)) - 1) << ": " << b.second << "\n";
+  }
+  log << "periods:\n";
+  for(auto const &p : periods) {
+    log << "  " << p.first << ": " << p.second << "\n";
+  }
+  if(options.census) {
+    auto const counts = objects.counts();
+    uint64_t total = 0;
+    for(auto const &c : counts) total += c.second;
+    log << "census: " << total << " objects, " << counts.size() << " distinct\n";
+    for(auto const &c : counts) {
+      log << "  " << c.first << " " << c.second << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef SOUP_HPP
+#define SOUP_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "bitrow.hpp"
+#include "rule.hpp"
+
+struct soup_result {
+  uint64_t index;
+  // generations until the soup entered its cycle
+  int lifetime;
+  // 0 when the soup hit the generation cap
+  int period;
+  uint64_t population;
+};
+
+// A small bit-packed torus reused for one soup after another. Periods are
+// found by remembering a hash of every generation in a table that is
+// invalidated per soup with an epoch counter instead of being cleared.
+class soup_board
+{
+  struct seen {
+    uint64_t hash;
+    uint32_t epoch;
+    int generation;
+  };
+
+  std::vector<uint64_t> next, scratch;
+  std::vector<seen> table;
+  uint32_t epoch;
+
+  uint64_t *row(std::vector<uint64_t> &g, const int &y) { return &g[(size_t)y*words]; }
+
+public:
+  int width;
+  int height;
+  int words;
+  bitrow::rule_counts counts;
+  std::vector<uint64_t> cur;
+
+public:
+  soup_board(const int &width, const int &height, const int &cap, const rule &r);
+
+  // fills a size x size square in the middle, percent of its cells alive
+  void seed(const uint64_t &seed, const uint64_t &index, const int &size, const int &percent);
+  void step();
+  uint64_t hash() const;
+  uint64_t population() const;
+  soup_result run(const uint64_t &index, const int &cap);
+};
+
+struct soup_options {
+  uint64_t soups;
+  uint64_t seed;
+  int board;
+  int size;
+  int percent;
+  int cap;
+  int threads;
+  rule life_rule;
+  // segment and classify the ash of every soup that settled
+  bool census;
+};
+
+// Runs soups in parallel, one line per soup on out, progress and a final
+// summary, with the object census if asked for, on log.
+int run_soups(const soup_options &options, std::ostream &out, std::ostream &log);
+
+#endif // SOUP_HPP
@@ -0,0 +1,40 @@
+// A cropped step is split by the learned costs of the columns it steps,
+// and its timings move the costs of just those columns.
+#include "check.hpp"
+#include "../balance.hpp"
+
+int main() {
+  balancer b(100, 2);
+
+  // untimed columns cost the same, so the pieces split by count
+  std::vector<balancer::ranges> parts;
+  b.split({{10, 20}, {60, 90}}, parts);
+  CHECK(parts[0] == (balancer::ranges{{10, 20}, {60, 70}}));
+  CHECK(parts[1] == (balancer::ranges{{70, 90}}));
+
+  // columns 60..70 turn out three times as slow as 70..90, which puts
+  // the best cut at 68 1/3
+  for(int g = 0; g < 20; g++) {
+    b.split({{60, 90}}, parts);
+    auto seconds = [] (const balancer::ranges &r) {
+      double s = 0;
+      for(auto const &run : r) {
+        for(int x = run.first; x < run.second; x++) s += x < 70 ? 3 : 1;
+      }
+      return s;
+    };
+    b.measured(0, seconds(parts[0]), parts[0]);
+    b.measured(1, seconds(parts[1]), parts[1]);
+    b.rebalance();
+  }
+  b.split({{60, 90}}, parts);
+  CHECK(parts[0].size() == 1 && parts[0][0].first == 60);
+  CHECK(parts[0][0].second >= 66 && parts[0][0].second <= 70);
+
+  // with adaptive off a split stays even
+  b.adaptive = false;
+  b.split({{60, 90}}, parts);
+  CHECK(parts[0] == (balancer::ranges{{60, 75}}));
+
+  return check::failures() != 0;
+}
@@ -0,0 +1,20 @@
+#ifndef TESTS_CHECK_HPP
+#define TESTS_CHECK_HPP
+
+#include <iostream>
+
+// Minimal assertions for the test programs: failures are counted and
+// reported, and main returns check::failures() != 0.
+namespace check {
+  inline int &failures() { static int n = 0; return n; }
+}
+
+#define CHECK(cond) \
+  do { \
+    if(!(cond)) { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n"; \
+      check::failures()++; \
+    } \
+  } while(0)
+
+#endif // TESTS_CHECK_HPP
@@ -0,0 +1,52 @@
+// Checkpoints carry their generation, and loading one restores both the
+// board and the generation; plain dumps without a trailer still load.
+#include <cstdio>
+#include <fstream>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "check.hpp"
+#include "../world.hpp"
+
+int main() {
+  const int width = 90, height = 40;
+  char dir_template[] = "/tmp/checkpoint_test_XXXXXX";
+  const std::string dir = mkdtemp(dir_template);
+  const std::string prefix = dir + "/checkpoint_";
+
+  world w(width, height, 2);
+  w.set_seed(99, 30);
+  w.seed_life();
+  w.checkpoint_dir = dir;
+  w.checkpoints.keep = 0;
+  w.checkpoint_every = 5;
+  for(int g = 0; g < 10; g++) w.next_generation();
+  w.checkpoints.wait_idle();
+  CHECK(w.checkpoints.written == 2);
+  CHECK(w.checkpoints.report() == "checkpoints: 2 written, 0 dropped");
+
+  world loaded(width, height, 3);
+  loaded.load_generation(prefix + "10.gol");
+  CHECK(loaded.generation == 10);
+  std::vector<char> expected, actual;
+  w.snapshot(expected);
+  loaded.snapshot(actual);
+  CHECK(actual == expected);
+
+  loaded.load_generation(prefix + "5.gol");
+  CHECK(loaded.generation == 5);
+
+  // a dump from before the trailer keeps the generation as it was
+  const std::string plain = dir + "/plain.gol";
+  std::ofstream(plain, std::ios::binary).write(expected.data(), expected.size());
+  loaded.load_generation(plain);
+  CHECK(loaded.generation == 5);
+  loaded.snapshot(actual);
+  CHECK(actual == expected);
+
+  for(auto name : {prefix + "5.gol", prefix + "10.gol", plain}) std::remove(name.c_str());
+  rmdir(dir.c_str());
+  return check::failures() != 0;
+}
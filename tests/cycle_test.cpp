@@ -0,0 +1,74 @@
+// A run with a target generation skips cycles, and lands on the same
+// board as stepping every generation, also when the board settles into
+// still lifes and blinkers that stepping reseeds.
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "../world.hpp"
+
+namespace {
+  const char *const pulsar[] = {
+    "..OOO...OOO..",
+    ".............",
+    "O....O.O....O",
+    "O....O.O....O",
+    "O....O.O....O",
+    "..OOO...OOO..",
+    ".............",
+    "..OOO...OOO..",
+    "O....O.O....O",
+    "O....O.O....O",
+    "O....O.O....O",
+    ".............",
+    "..OOO...OOO..",
+  };
+
+  // the board at generation target, with or without skipping cycles;
+  // jumped tells whether a cycle was skipped
+  std::vector<char> run(const int &width, const int &height, const bool &soup, const int &target,
+                        const bool &skip, bool &jumped) {
+    world w(width, height, 2);
+    w.set_seed(31, 30);
+    if(soup) {
+      w.seed_life();
+    }
+    else {
+      w.seed_life(false);
+      auto b = std::make_shared<brush>();
+      b->width = b->height = 13;
+      for(auto row : pulsar) {
+        for(int x = 0; x < 13; x++) b->alive.push_back(row[x] == 'O');
+      }
+      w.edits.push(edit{edit::paste, 3, 2, 0, 0, true, b});
+    }
+    if(skip) w.target_generation = target;
+    while(w.generation < target) w.next_generation();
+    jumped = w.jumped_from >= 0;
+    CHECK(w.generation == target);
+    std::vector<char> board;
+    w.snapshot(board);
+    return board;
+  }
+
+  void compare(const int &width, const int &height, const bool &soup, const int &target, const bool &expect_jump) {
+    bool jumped = false, stepped_jumped = false;
+    const auto skipped = run(width, height, soup, target, true, jumped);
+    const auto stepped = run(width, height, soup, target, false, stepped_jumped);
+    CHECK(skipped == stepped);
+    CHECK(!stepped_jumped);
+    if(expect_jump) CHECK(jumped);
+  }
+}
+
+int main() {
+  // period 3, on a fixed board and on the cell grid
+  compare(40, 16, false, 1001, true);
+  compare(100, 60, false, 1001, true);
+  compare(100, 60, false, 1002, true);
+  // soups end in period 1 and 2 ash, which stepping reseeds
+  compare(40, 16, true, 1001, false);
+  compare(64, 48, true, 3001, false);
+  return check::failures() != 0;
+}
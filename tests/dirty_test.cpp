@@ -0,0 +1,72 @@
+// A picture of the board kept up to date only where take_dirty_segments
+// says it is dirty stays equal to the board, and so does a density
+// pyramid updated from the same rows, across cropped steps, fixed
+// boards, multi-state rules and edits.
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "../world.hpp"
+#include "../density.hpp"
+
+namespace {
+  // what the window draws for a cell: its state, or for two states
+  // whether it is alive now and was alive before
+  int code(const world &w, const int &x, const int &y) {
+    if(w.multi_state()) return w.cell_state(x, y);
+    return w.cells[x][y].alive | w.last_gen[x][y].alive << 1;
+  }
+
+  void run(const int &width, const int &height, const rule &r, const bool &soup) {
+    world w(width, height, 3);
+    w.set_rule(r);
+    w.set_seed(11, 30);
+    w.seed_life(soup);
+    if(!soup) {
+      auto glider = std::make_shared<brush>(brush::glider());
+      w.edits.push(edit{edit::paste, 5, 5, 0, 0, true, glider});
+      w.edits.push(edit{edit::paste, width-3, height-3, 0, 0, true, glider});
+    }
+
+    std::vector<char> segments;
+    std::vector<int> rows;
+    std::vector< std::vector<int> > picture(width, std::vector<int>(height, -1));
+    density_pyramid pyramid(width, height);
+    for(int g = 0; g < 120; g++) {
+      if(g == 60) w.edits.push(edit{edit::line, 0, height/2, width-1, height/2, true, nullptr});
+      w.next_generation();
+      w.take_dirty_segments(segments, rows);
+      pyramid.update(w, segments, rows);
+      for(size_t i = 1; i < rows.size(); i++) CHECK(rows[i-1] < rows[i]);
+      for(auto y : rows) {
+        for(int s = 0; s < w.segments_per_row; s++) {
+          if(!segments[(size_t)y*w.segments_per_row + s]) continue;
+          const int x1 = std::min(width, (s+1)*world::segment_width);
+          for(int x = s*world::segment_width; x < x1; x++) picture[x][y] = code(w, x, y);
+        }
+      }
+
+      int wrong = 0;
+      for(int x = 0; x < width; x++) {
+        for(int y = 0; y < height; y++) wrong += picture[x][y] != code(w, x, y);
+      }
+      CHECK(wrong == 0);
+      density_pyramid fresh(width, height);
+      std::vector<char> all(segments.size(), 1);
+      std::vector<int> every(height);
+      for(int y = 0; y < height; y++) every[y] = y;
+      fresh.update(w, all, every);
+      CHECK(fresh.levels == pyramid.levels);
+      if(wrong) return;
+    }
+  }
+}
+
+int main() {
+  run(40, 16, rules::conway, true);
+  run(300, 90, rules::conway, true);
+  run(300, 90, rules::conway, false);
+  run(130, 70, rules::brians_brain, true);
+  return check::failures() != 0;
+}
@@ -0,0 +1,89 @@
+// Ranks forked over each transport step the same torus as a single
+// world drawn from the same seed, and a batch of steps between two
+// exchanges is only stable when every step in it is.
+#include <algorithm>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "check.hpp"
+#include "../world.hpp"
+#include "../distributed.hpp"
+
+namespace {
+  const int width = 150, height = 70;
+  const uint64_t seed = 777;
+  const int percent = 30;
+  const long generations = 41;
+
+  bool alive(const domain &d, const int &x, const int &y) {
+    const int bit = d.k + x;
+    return (d.cur[(size_t)(d.k+y)*d.words + bit/64] >> (bit%64)) & 1;
+  }
+
+  // one rank's run; true when its rectangle matches the single world
+  bool run(const std::string &kind, const int &rank, const int &ranks, const int &halo,
+           const std::string &session, const int &port) {
+    auto t = make_transport(kind, rank, ranks, session, port);
+    domain d(rank, ranks, width, height, halo, rules::conway);
+    d.seed_life(seed, percent);
+    for(long generation = 0; generation < generations; generation += d.k) {
+      d.exchange(*t);
+      d.advance((int)std::min<long>(d.k, generations - generation));
+    }
+    t->barrier();
+
+    world w(width, height, 1);
+    w.set_seed(seed, percent);
+    w.seed_life();
+    for(long generation = 0; generation < generations; generation++) w.next_generation();
+    for(int y = 0; y < d.h; y++) {
+      for(int x = 0; x < d.w; x++) {
+        if(alive(d, x, y) != w.cells[d.gx+x][d.gy+y].alive) return false;
+      }
+    }
+    return true;
+  }
+
+  // forks every rank, true when all of them matched
+  bool fork_ranks(const std::string &kind, const int &ranks, const int &halo) {
+    const std::string session = "test-" + std::to_string(getpid()) + "-" + kind + "-" + std::to_string(ranks);
+    const int port = 47000 + (getpid() % 1000)*16;
+    for(int rank = 0; rank < ranks; rank++) {
+      if(fork() == 0) {
+        bool same = false;
+        try {
+          same = run(kind, rank, ranks, halo, session, port);
+        }
+        catch(std::exception &e) {
+          std::cerr << kind << " rank " << rank << ": " << e.what() << "\n";
+        }
+        _exit(same ? 0 : 1);
+      }
+    }
+    bool all = true;
+    for(int rank = 0; rank < ranks; rank++) {
+      int status = 0;
+      if(wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) all = false;
+    }
+    return all;
+  }
+}
+
+int main() {
+  for(auto kind : {"shm", "unix", "tcp"}) {
+    CHECK(fork_ranks(kind, 1, 1));
+    CHECK(fork_ranks(kind, 4, 3));
+    CHECK(fork_ranks(kind, 6, 2));
+  }
+
+  // a lone cell dies in the first step, so the second one differs from
+  // the board two generations before even though the third doesn't
+  domain d(0, 1, 64, 64, 3, rules::conway);
+  d.cur[(size_t)(d.k+10)*d.words] = 1ull << (d.k+10);
+  CHECK(!d.advance(3));
+  CHECK(d.advance(3));
+
+  return check::failures() != 0;
+}
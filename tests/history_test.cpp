@@ -0,0 +1,74 @@
+// Stepping back through the recorded generations gives back every board
+// exactly, for two-state and multi-state rules, and after the oldest
+// keyframes were dropped to stay within the budget. Fixed boards record
+// from their row words without bringing the cells up to date.
+#include <vector>
+
+#include "check.hpp"
+#include "../world.hpp"
+
+namespace {
+  const int generations = 60;
+
+  // steps forward, then back as far as the history goes; the number of
+  // generations it got back, or -1 on a board that differs
+  int round_trip(const rule &r, const size_t &budget, const int &keyframe_every,
+                 const int &width = 120, const int &height = 80) {
+    world w(width, height, 2);
+    w.rewind.budget = budget;
+    w.rewind.keyframe_every = keyframe_every;
+    w.set_rule(r);
+    w.set_seed(2024, 35);
+    w.seed_life();
+
+    std::vector< std::vector<uint64_t> > boards(1);
+    w.pack_board(boards[0]);
+    for(int g = 0; g < generations; g++) {
+      w.next_generation();
+      boards.emplace_back();
+      w.pack_board(boards.back());
+    }
+
+    std::vector<uint64_t> board;
+    int back = 0;
+    while(w.step_back()) {
+      back++;
+      w.pack_board(board);
+      if(w.generation != generations - back || board != boards[w.generation]) return -1;
+    }
+    return back;
+  }
+}
+
+int main() {
+  const size_t plenty = 64 << 20;
+  CHECK(round_trip(rules::conway, plenty, 256) == generations);
+  CHECK(round_trip(rules::conway, plenty, 8) == generations);
+  CHECK(round_trip(rules::brians_brain, plenty, 8) == generations);
+
+  // a budget of a few keyframes keeps only the newest generations
+  for(auto r : {rules::conway, rules::brians_brain}) {
+    const int back = round_trip(r, 24 << 10, 8);
+    CHECK(back > 0);
+    CHECK(back < generations);
+  }
+
+  // 40x16 steps on a fixed board
+  CHECK(round_trip(rules::conway, plenty, 8, 40, 16) == generations);
+  world fixed(40, 16, 1), cells(40, 16, 1);
+  cells.set_kernel("table");
+  CHECK(fixed.fixed && !cells.fixed);
+  fixed.rewind.budget = plenty;
+  for(auto w : {&fixed, &cells}) {
+    w->set_seed(5, 35);
+    w->seed_life();
+    for(int g = 0; g < 30; g++) w->next_generation();
+  }
+  CHECK(fixed.cells_stale);
+  std::vector<uint64_t> from_rows, from_cells;
+  fixed.pack_board(from_rows);
+  cells.pack_board(from_cells);
+  CHECK(from_rows == from_cells);
+
+  return check::failures() != 0;
+}
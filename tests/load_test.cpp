@@ -0,0 +1,72 @@
+// Text patterns load the same whatever the number of workers, also when
+// lines are wrapped anywhere within rows and the file's parts begin or
+// end in the middle of a line break.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include "check.hpp"
+#include "../world.hpp"
+
+namespace {
+  std::string dir;
+
+  // the board as row-major '0' and '.', or empty when loading failed
+  std::string load(const std::string &text, const int &width, const int &height, const int &threads) {
+    const std::string path = dir + "/pattern.txt";
+    std::ofstream(path, std::ios::binary) << text;
+    world w(width, height, threads);
+    try {
+      w.load_generation(path, false);
+    }
+    catch(const std::runtime_error &e) {
+      std::cerr << e.what() << "\n";
+      return "";
+    }
+    std::remove(path.c_str());
+    std::string board;
+    for(int y = 0; y < height; y++) {
+      for(int x = 0; x < width; x++) board += w.cells[x][y].alive ? '0' : '.';
+    }
+    return board;
+  }
+
+  // board with a line break after every line cells, the next break
+  // being "\r\n" whenever crlf
+  std::string wrap(const std::string &board, const int &line, const bool &crlf) {
+    std::string text;
+    for(size_t i = 0; i < board.size(); i += line) {
+      text += board.substr(i, line);
+      text += crlf ? "\r\n" : "\n";
+    }
+    return text;
+  }
+}
+
+int main() {
+  char dir_template[] = "/tmp/load_test_XXXXXX";
+  dir = mkdtemp(dir_template);
+
+  // the second line starts in the middle of row 0 on the third worker
+  CHECK(load("0.0.0.\n0.0.0.0.0.\n", 8, 2, 3) == "0.0.0.0.0.0.0.0.");
+
+  const int width = 37, height = 29;
+  std::string board;
+  srand(7);
+  for(int i = 0; i < width*height; i++) board += rand() % 3 ? '.' : '0';
+
+  for(int line : {width, 1, 5, 16, 36, 38, 100}) {
+    for(bool crlf : {false, true}) {
+      const std::string text = wrap(board, line, crlf);
+      const std::string single = load(text, width, height, 1);
+      CHECK(single == board);
+      for(int threads = 2; threads <= 9; threads++) CHECK(load(text, width, height, threads) == single);
+    }
+  }
+
+  rmdir(dir.c_str());
+  return check::failures() != 0;
+}
@@ -0,0 +1,83 @@
+// The board drawn from a seed is the same for world, mapped_world and
+// the ranks of a distributed run, whatever their worker or rank count.
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "check.hpp"
+#include "../world.hpp"
+#include "../mapped_world.hpp"
+#include "../distributed.hpp"
+
+namespace {
+  const int width = 150, height = 70;
+  const uint64_t seed = 12345;
+  const int percent = 30;
+
+  typedef std::vector<std::vector<char>> board;
+
+  board world_board(world &w) {
+    board b(width, std::vector<char>(height));
+    for(int x = 0; x < width; x++) {
+      for(int y = 0; y < height; y++) b[x][y] = w.cells[x][y].alive;
+    }
+    return b;
+  }
+
+  board mapped_board(const int &threads) {
+    const std::string path = "/tmp/seed_test_" + std::to_string(getpid()) + ".grid";
+    board b(width, std::vector<char>(height));
+    {
+      mapped_world mw(path, width, height, threads);
+      mw.seed_life(seed, percent);
+      for(int y = 0; y < height; y++) {
+        const uint64_t *row = mw.row(y);
+        for(int x = 0; x < width; x++) b[x][y] = (row[x/64] >> (x%64)) & 1;
+      }
+    }
+    unlink(path.c_str());
+    return b;
+  }
+
+  board distributed_board(const int &ranks) {
+    board b(width, std::vector<char>(height));
+    for(int rank = 0; rank < ranks; rank++) {
+      domain d(rank, ranks, width, height, 1, rules::conway);
+      d.seed_life(seed, percent);
+      for(int y = 0; y < d.h; y++) {
+        for(int x = 0; x < d.w; x++) {
+          const int bit = d.k + x;
+          b[d.gx+x][d.gy+y] = (d.cur[(size_t)(d.k+y)*d.words + bit/64] >> (bit%64)) & 1;
+        }
+      }
+    }
+    return b;
+  }
+}
+
+int main() {
+  world reference(width, height, 1);
+  reference.set_seed(seed, percent);
+  reference.seed_life();
+  const board first = world_board(reference);
+
+  int live = 0;
+  for(auto &column : first) for(auto alive : column) live += alive;
+  CHECK(live > width*height/5 && live < width*height*2/5);
+
+  for(int threads : {2, 3, 7}) {
+    world w(width, height, threads);
+    w.set_seed(seed, percent);
+    w.seed_life();
+    CHECK(world_board(w) == first);
+  }
+  for(int threads : {1, 3}) CHECK(mapped_board(threads) == first);
+  for(int ranks : {1, 2, 4, 6}) CHECK(distributed_board(ranks) == first);
+
+  // reseeding draws a different board
+  reference.seed_life();
+  CHECK(world_board(reference) != first);
+
+  return check::failures() != 0;
+}
@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "text_overlay.hpp"
+
+text_overlay::text_overlay(SDL_Renderer *renderer, TTF_Font *font, const SDL_Color &color)
+{
+    glyphs.fill(glyph{SDL_Rect{0,0,0,0}, 0});
+    if(!font) return;
+
+    // the Color constants leave alpha at 0, blended glyphs need it opaque
+    SDL_Color const fg{color.r, color.g, color.b, 255};
+    std::vector<sdl2::surface_ptr_t> rendered;
+    int atlas_w = 0;
+    line_height = TTF_FontHeight(font);
+
+    for(char ch = first_char; ch <= last_char; ch++) {
+        auto &g = glyphs[ch-first_char];
+        int minx, maxx, miny, maxy;
+        TTF_GlyphMetrics(font, (Uint16)ch, &minx, &maxx, &miny, &maxy, &g.advance);
+        sdl2::surface_ptr_t s(TTF_RenderGlyph_Blended(font, (Uint16)ch, fg), SDL_Deleter());
+        if(s) {
+            g.src = SDL_Rect{atlas_w, 0, s->w, s->h};
+            atlas_w += s->w;
+        }
+        rendered.push_back(std::move(s));
+    }
+
+    sdl2::surface_ptr_t sheet(
+            SDL_CreateRGBSurface(0, std::max(atlas_w, 1), std::max(line_height, 1), 32,
+                                 0x00FF0000,
+                                 0x0000FF00,
+                                 0x000000FF,
+                                 0xFF000000),
+            SDL_Deleter());
+    if(!sheet) return;
+
+    for(size_t i = 0; i < rendered.size(); i++) {
+        if(!rendered[i]) continue;
+        SDL_Rect dst = glyphs[i].src;
+        SDL_SetSurfaceBlendMode(rendered[i].get(), SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(rendered[i].get(), NULL, sheet.get(), &dst);
+    }
+
+    atlas.reset(SDL_CreateTextureFromSurface(renderer, sheet.get()));
+    if(atlas) SDL_SetTextureBlendMode(atlas.get(), SDL_BLENDMODE_BLEND);
+}
+
+void text_overlay::set_text(const std::string &new_text, const SDL_Rect &new_bounds) {
+    if(new_text == text &&
+       new_bounds.x == bounds.x && new_bounds.y == bounds.y &&
+       new_bounds.w == bounds.w && new_bounds.h == bounds.h) {
+        return;
+    }
+    text = new_text;
+    bounds = new_bounds;
+    layout();
+}
+
+void text_overlay::layout() {
+    src_quads.clear();
+    dst_quads.clear();
+
+    // lay out in atlas pixels first, then scale everything into bounds
+    int pen = 0;
+    int text_w = 0;
+    for(char ch : text) {
+        if(ch < first_char || ch > last_char) ch = '?';
+        auto const &g = glyphs[ch-first_char];
+        if(g.src.w > 0) {
+            src_quads.push_back(g.src);
+            dst_quads.push_back(SDL_Rect{pen, 0, g.src.w, g.src.h});
+            text_w = std::max(text_w, pen+g.src.w);
+        }
+        pen += g.advance;
+    }
+    if(text_w == 0 || line_height == 0) return;
+
+    auto const sx = (float)bounds.w/text_w;
+    auto const sy = (float)bounds.h/line_height;
+    for(auto &q : dst_quads) {
+        int const x0 = bounds.x + (int)(q.x*sx);
+        int const x1 = bounds.x + (int)((q.x+q.w)*sx);
+        q = SDL_Rect{x0, bounds.y, x1-x0, (int)(q.h*sy)};
+    }
+}
+
+void text_overlay::draw(SDL_Renderer *renderer) const {
+    if(!atlas || text.empty()) return;
+
+    SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b, background.a);
+    SDL_RenderFillRect(renderer, &bounds);
+
+    // one atlas texture for every quad, so the renderer can batch them
+    for(size_t i = 0; i < dst_quads.size(); i++) {
+        SDL_RenderCopy(renderer, atlas.get(), &src_quads[i], &dst_quads[i]);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TEXT_OVERLAY_HPP
+#define TEXT_OVERLAY_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "sdl2.hpp"
+
+// Draws single-line ASCII text from a glyph atlas that is rendered once
+// at startup. Changing the text only re-lays out quads; no surfaces or
+// textures are created per frame.
+class text_overlay {
+    struct glyph {
+        SDL_Rect src;
+        int advance;
+    };
+
+    static const char first_char = ' ';
+    static const char last_char = '~';
+
+    sdl2::texture_ptr_t atlas;
+    std::array<glyph, last_char-first_char+1> glyphs;
+    int line_height = 0;
+
+    std::string text;
+    SDL_Rect bounds{0,0,0,0};
+    std::vector<SDL_Rect> src_quads;
+    std::vector<SDL_Rect> dst_quads;
+
+    void layout();
+
+public:
+    SDL_Color background{0,0,0,255};
+
+    text_overlay(SDL_Renderer *renderer, TTF_Font *font, const SDL_Color &color);
+
+    // text is stretched to fill bounds, like the old shaded text texture
+    void set_text(const std::string &text, const SDL_Rect &bounds);
+    void draw(SDL_Renderer *renderer) const;
+};
+
+#endif //TEXT_OVERLAY_HPP
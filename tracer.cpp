@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <iomanip>
+
+#include <unistd.h>
+
+#include "tracer.hpp"
+
+std::atomic<tracer*> tracer::active(nullptr);
+
+namespace {
+  // the ring of the current thread and the tracer it belongs to
+  thread_local tracer *owner = nullptr;
+  thread_local tracer::ring *own_ring = nullptr;
+}
+
+tracer::ring::ring(const size_t &capacity, const int &id)
+  : events(capacity),
+    added(0),
+    id(id)
+{
+}
+
+std::vector<tracer::event> tracer::ring::recorded() const {
+  auto const n = added.load(std::memory_order_acquire);
+  auto const size = (uint64_t)events.size();
+  std::vector<event> out;
+  out.reserve(std::min(n, size));
+  for(uint64_t i = n > size ? n - size : 0; i < n; i++) out.push_back(events[i % size]);
+  return out;
+}
+
+tracer::tracer(const size_t &capacity)
+  : capacity(std::max<size_t>(capacity, 1)),
+    epoch(std::chrono::steady_clock::now())
+{
+}
+
+tracer::ring *tracer::make_ring() {
+  std::lock_guard<std::mutex> lock(mutex);
+  rings.emplace_back(new ring(capacity, (int)rings.size()));
+  return rings.back().get();
+}
+
+tracer::ring *tracer::this_thread() {
+  if(owner != this) {
+    own_ring = make_ring();
+    owner = this;
+  }
+  return own_ring;
+}
+
+void tracer::label_thread(const std::string &label, const int &index) {
+  auto r = this_thread();
+  if(!r->label.empty()) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  r->label = index < 0 ? label : label + " " + std::to_string(index);
+}
+
+void tracer::dump(std::ostream &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto const pid = getpid();
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+  bool first = true;
+  for(auto const &r : rings) {
+    auto const label = r->label.empty() ? "thread " + std::to_string(r->id) : r->label;
+    out << (first ? "" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << r->id
+        << ",\"args\":{\"name\":\"" << label << "\"}}";
+    first = false;
+    for(auto const &e : r->recorded()) {
+      out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\""
+          << ",\"ts\":" << e.start/1e3 << ",\"dur\":" << (e.end - e.start)/1e3
+          << ",\"pid\":" << pid << ",\"tid\":" << r->id << "}";
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
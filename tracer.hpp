@@ -0,0 +1,104 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Records when pool tasks and the phases of a generation or frame start
+// and end, for looking at worker balance in a trace viewer. Each thread
+// writes to a ring of its own, so recording takes no lock; the oldest
+// events are overwritten once a ring is full. Tracing is off unless a
+// tracer is made active, and then costs two clock reads per scope.
+class tracer
+{
+public:
+  struct event {
+    const char *name;
+    const char *category;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  class ring {
+    std::vector<event> events;
+    // events ever added; the newest is at (added-1) % size
+    std::atomic<uint64_t> added;
+
+  public:
+    std::string label;
+    int id;
+
+  public:
+    ring(const size_t &capacity, const int &id);
+    void add(const char *name, const char *category, const uint64_t &start, const uint64_t &end) {
+      auto const n = added.load(std::memory_order_relaxed);
+      events[n % events.size()] = event{name, category, start, end};
+      added.store(n+1, std::memory_order_release);
+    }
+    // oldest first
+    std::vector<event> recorded() const;
+  };
+
+private:
+  std::mutex mutex;
+  std::vector< std::unique_ptr<ring> > rings;
+  size_t capacity;
+  const std::chrono::steady_clock::time_point epoch;
+
+  ring *make_ring();
+
+public:
+  static std::atomic<tracer*> active;
+
+public:
+  // events kept per thread
+  explicit tracer(const size_t &capacity = 1 << 16);
+
+  // nanoseconds since the tracer was made
+  uint64_t now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+  }
+  // the calling thread's ring
+  ring *this_thread();
+  // names the calling thread in the trace, e.g. "worker" 3
+  void label_thread(const std::string &label, const int &index = -1);
+  // Chrome trace-event JSON; call while no thread is recording
+  void dump(std::ostream &out);
+};
+
+// Records the time from construction to destruction as one event on the
+// calling thread, if a tracer is active.
+class trace_scope
+{
+  tracer *t;
+  tracer::ring *ring;
+  const char *name;
+  const char *category;
+  uint64_t start;
+
+public:
+  // with record false nothing is recorded, for scopes too short to time
+  trace_scope(const char *name, const char *category = "phase", const bool &record = true)
+    : t(record ? tracer::active.load(std::memory_order_relaxed) : nullptr),
+      ring(t ? t->this_thread() : nullptr),
+      name(name),
+      category(category),
+      start(t ? t->now() : 0)
+  {
+  }
+
+  ~trace_scope() {
+    if(ring) ring->add(name, category, start, t->now());
+  }
+
+  trace_scope(const trace_scope &) = delete;
+  trace_scope &operator=(const trace_scope &) = delete;
+};
+
+#endif // TRACER_HPP
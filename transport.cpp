@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "transport.hpp"
+
+namespace {
+  std::runtime_error sys_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+  }
+
+  const auto connect_timeout = std::chrono::seconds(30);
+
+  // One socket per peer, full mesh. Lower ranks listen, higher ranks
+  // connect and introduce themselves with their rank.
+  class socket_transport : public transport
+  {
+    std::vector<int> fds;
+    int listener;
+    std::string unix_path;
+
+    sockaddr_storage address(const int &of, socklen_t &len, const bool &unix_socket,
+                             const std::string &session, const int &port) {
+      sockaddr_storage addr;
+      std::memset(&addr, 0, sizeof(addr));
+      if(unix_socket) {
+        auto *un = (sockaddr_un*)&addr;
+        un->sun_family = AF_UNIX;
+        std::string path = "/tmp/golgl-" + session + "-" + std::to_string(of) + ".sock";
+        std::strncpy(un->sun_path, path.c_str(), sizeof(un->sun_path)-1);
+        len = sizeof(sockaddr_un);
+      }
+      else {
+        auto *in = (sockaddr_in*)&addr;
+        in->sin_family = AF_INET;
+        in->sin_port = htons((uint16_t)(port + of));
+        in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        len = sizeof(sockaddr_in);
+      }
+      return addr;
+    }
+
+    static void write_all(int fd, const void *data, size_t bytes) {
+      auto *p = (const char*)data;
+      while(bytes) {
+        ssize_t n = ::write(fd, p, bytes);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) throw sys_error("socket write");
+        p += n;
+        bytes -= n;
+      }
+    }
+
+    static void read_all(int fd, void *data, size_t bytes) {
+      auto *p = (char*)data;
+      while(bytes) {
+        ssize_t n = ::read(fd, p, bytes);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) throw std::runtime_error("peer closed the connection");
+        p += n;
+        bytes -= n;
+      }
+    }
+
+  public:
+    socket_transport(const int &rank, const int &size, const bool &unix_socket,
+                     const std::string &session, const int &port)
+      : transport(rank, size),
+        fds(size, -1),
+        listener(-1)
+    {
+      const int family = unix_socket ? AF_UNIX : AF_INET;
+      socklen_t len;
+
+      if(rank < size-1) {
+        listener = ::socket(family, SOCK_STREAM, 0);
+        if(listener < 0) throw sys_error("socket");
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        auto addr = address(rank, len, unix_socket, session, port);
+        if(unix_socket) {
+          unix_path = ((sockaddr_un*)&addr)->sun_path;
+          ::unlink(unix_path.c_str());
+        }
+        if(::bind(listener, (sockaddr*)&addr, len) != 0) throw sys_error("bind");
+        if(::listen(listener, size) != 0) throw sys_error("listen");
+      }
+
+      for(int peer = 0; peer < rank; peer++) {
+        auto addr = address(peer, len, unix_socket, session, port);
+        auto const deadline = std::chrono::steady_clock::now() + connect_timeout;
+        for(;;) {
+          int fd = ::socket(family, SOCK_STREAM, 0);
+          if(fd < 0) throw sys_error("socket");
+          if(::connect(fd, (sockaddr*)&addr, len) == 0) {
+            fds[peer] = fd;
+            break;
+          }
+          ::close(fd);
+          if(std::chrono::steady_clock::now() > deadline) throw sys_error("connect to rank " + std::to_string(peer));
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        int32_t me = rank;
+        write_all(fds[peer], &me, sizeof(me));
+      }
+
+      for(int accepted = rank+1; accepted < size; accepted++) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if(fd < 0) throw sys_error("accept");
+        int32_t peer;
+        read_all(fd, &peer, sizeof(peer));
+        if(peer <= rank || peer >= size || fds[peer] >= 0) throw std::runtime_error("unexpected peer rank");
+        fds[peer] = fd;
+      }
+
+      for(int fd : fds) {
+        if(fd < 0) continue;
+        if(!unix_socket) {
+          int one = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      }
+    }
+
+    ~socket_transport() {
+      for(int fd : fds) if(fd >= 0) ::close(fd);
+      if(listener >= 0) ::close(listener);
+      if(!unix_path.empty()) ::unlink(unix_path.c_str());
+    }
+
+    void sendrecv(const int &to, const void *out, const size_t &out_bytes,
+                  const int &from, void *in, const size_t &in_bytes) override {
+      if(to == rank || from == rank) {
+        if(to != from || out_bytes != in_bytes) throw std::logic_error("self sendrecv must be symmetric");
+        std::memcpy(in, out, in_bytes);
+        return;
+      }
+
+      auto *op = (const char*)out;
+      auto *ip = (char*)in;
+      size_t to_send = to >= 0 ? out_bytes : 0;
+      size_t to_recv = from >= 0 ? in_bytes : 0;
+      bytes_sent += to_send;
+
+      while(to_send || to_recv) {
+        pollfd p[2];
+        int n = 0;
+        if(to_send) p[n++] = pollfd{fds[to], POLLOUT, 0};
+        if(to_recv) p[n++] = pollfd{fds[from], POLLIN, 0};
+        if(::poll(p, n, -1) < 0) {
+          if(errno == EINTR) continue;
+          throw sys_error("poll");
+        }
+        for(int i = 0; i < n; i++) {
+          if(p[i].revents & (POLLERR | POLLNVAL)) throw std::runtime_error("socket error");
+          if(p[i].events == POLLOUT && (p[i].revents & POLLOUT)) {
+            ssize_t w = ::write(fds[to], op, to_send);
+            if(w < 0 && errno != EAGAIN && errno != EINTR) throw sys_error("socket write");
+            if(w > 0) { op += w; to_send -= w; }
+          }
+          if(p[i].events == POLLIN && (p[i].revents & (POLLIN | POLLHUP))) {
+            ssize_t r = ::read(fds[from], ip, to_recv);
+            if(r == 0) throw std::runtime_error("peer closed the connection");
+            if(r < 0 && errno != EAGAIN && errno != EINTR) throw sys_error("socket read");
+            if(r > 0) { ip += r; to_recv -= r; }
+          }
+        }
+      }
+    }
+  };
+
+  // Single-producer single-consumer byte rings, one per ordered pair of
+  // ranks, in a POSIX shared memory segment.
+  class shm_transport : public transport
+  {
+    static const size_t capacity = 1 << 20;
+
+    struct channel {
+      std::atomic<uint64_t> head;
+      char pad[56];
+      std::atomic<uint64_t> tail;
+      char pad2[56];
+      uint8_t data[capacity];
+    };
+
+    std::string name;
+    size_t bytes;
+    channel *channels;
+
+    channel &between(const int &from, const int &to) { return channels[(size_t)from*size + to]; }
+
+    size_t push(channel &c, const uint8_t *data, size_t n) {
+      const uint64_t head = c.head.load(std::memory_order_relaxed);
+      const uint64_t tail = c.tail.load(std::memory_order_acquire);
+      n = std::min<size_t>(n, capacity - (head - tail));
+      for(size_t done = 0; done < n;) {
+        const size_t at = (head + done) % capacity;
+        const size_t chunk = std::min(n - done, capacity - at);
+        std::memcpy(&c.data[at], data + done, chunk);
+        done += chunk;
+      }
+      c.head.store(head + n, std::memory_order_release);
+      return n;
+    }
+
+    size_t pop(channel &c, uint8_t *data, size_t n) {
+      const uint64_t tail = c.tail.load(std::memory_order_relaxed);
+      const uint64_t head = c.head.load(std::memory_order_acquire);
+      n = std::min<size_t>(n, head - tail);
+      for(size_t done = 0; done < n;) {
+        const size_t at = (tail + done) % capacity;
+        const size_t chunk = std::min(n - done, capacity - at);
+        std::memcpy(data + done, &c.data[at], chunk);
+        done += chunk;
+      }
+      c.tail.store(tail + n, std::memory_order_release);
+      return n;
+    }
+
+  public:
+    shm_transport(const int &rank, const int &size, const std::string &session)
+      : transport(rank, size),
+        name("/golgl-" + session),
+        bytes(sizeof(channel)*size*size),
+        channels(nullptr)
+    {
+      int fd;
+      if(rank == 0) {
+        ::shm_unlink(name.c_str());
+        fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0) throw sys_error("shm_open " + name);
+        if(::ftruncate(fd, bytes) != 0) throw sys_error("ftruncate " + name);
+      }
+      else {
+        // wait for rank 0 to create and size the segment
+        auto const deadline = std::chrono::steady_clock::now() + connect_timeout;
+        for(;;) {
+          fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+          struct stat st;
+          if(fd >= 0 && fstat(fd, &st) == 0 && (size_t)st.st_size == bytes) break;
+          if(fd >= 0) ::close(fd);
+          if(std::chrono::steady_clock::now() > deadline) throw std::runtime_error("no shared memory segment " + name);
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+      }
+      void *m = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if(m == MAP_FAILED) throw sys_error("mmap " + name);
+      // a fresh segment is zero filled, which is an empty ring
+      channels = (channel*)m;
+    }
+
+    ~shm_transport() {
+      if(channels) ::munmap(channels, bytes);
+      if(rank == 0) ::shm_unlink(name.c_str());
+    }
+
+    void sendrecv(const int &to, const void *out, const size_t &out_bytes,
+                  const int &from, void *in, const size_t &in_bytes) override {
+      if(to == rank || from == rank) {
+        if(to != from || out_bytes != in_bytes) throw std::logic_error("self sendrecv must be symmetric");
+        std::memcpy(in, out, in_bytes);
+        return;
+      }
+
+      auto *op = (const uint8_t*)out;
+      auto *ip = (uint8_t*)in;
+      size_t to_send = to >= 0 ? out_bytes : 0;
+      size_t to_recv = from >= 0 ? in_bytes : 0;
+      bytes_sent += to_send;
+
+      while(to_send || to_recv) {
+        size_t progress = 0;
+        if(to_send) {
+          size_t n = push(between(rank, to), op, to_send);
+          op += n; to_send -= n; progress += n;
+        }
+        if(to_recv) {
+          size_t n = pop(between(from, rank), ip, to_recv);
+          ip += n; to_recv -= n; progress += n;
+        }
+        if(!progress) std::this_thread::yield();
+      }
+    }
+  };
+}
+
+void transport::allreduce(std::vector<uint64_t> &values, const reduce_op &op) {
+  const size_t bytes = values.size()*sizeof(uint64_t);
+  if(rank == 0) {
+    std::vector<uint64_t> other(values.size());
+    for(int peer = 1; peer < size; peer++) {
+      recv(peer, other.data(), bytes);
+      for(size_t i = 0; i < values.size(); i++) {
+        switch(op) {
+          case sum: values[i] += other[i]; break;
+          case min: values[i] = std::min(values[i], other[i]); break;
+          case max: values[i] = std::max(values[i], other[i]); break;
+        }
+      }
+    }
+    for(int peer = 1; peer < size; peer++) send(peer, values.data(), bytes);
+  }
+  else {
+    send(0, values.data(), bytes);
+    recv(0, values.data(), bytes);
+  }
+}
+
+void transport::barrier() {
+  std::vector<uint64_t> none(1, 0);
+  allreduce(none, sum);
+}
+
+std::unique_ptr<transport> make_transport(const std::string &kind, const int &rank, const int &size,
+                                          const std::string &session, const int &port) {
+  if(kind == "shm") return std::unique_ptr<transport>(new shm_transport(rank, size, session));
+  if(kind == "unix") return std::unique_ptr<transport>(new socket_transport(rank, size, true, session, port));
+  if(kind == "tcp") return std::unique_ptr<transport>(new socket_transport(rank, size, false, session, port));
+  throw std::invalid_argument("unknown transport " + kind + ", use shm, unix or tcp");
+}
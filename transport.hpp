@@ -0,0 +1,42 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Moves bytes between the ranks of a distributed run. Every rank can
+// reach every other rank; sending to yourself is a plain copy.
+class transport
+{
+public:
+  int rank;
+  int size;
+  uint64_t bytes_sent;
+
+public:
+  transport(const int &rank, const int &size) : rank(rank), size(size), bytes_sent(0) { }
+  virtual ~transport() { }
+
+  // Sends to one rank while receiving from another (either may be -1 for
+  // none), making progress on both so that rings of ranks can't deadlock
+  // on full buffers.
+  virtual void sendrecv(const int &to, const void *out, const size_t &out_bytes,
+                        const int &from, void *in, const size_t &in_bytes) = 0;
+
+  void send(const int &to, const void *out, const size_t &bytes) { sendrecv(to, out, bytes, -1, nullptr, 0); }
+  void recv(const int &from, void *in, const size_t &bytes) { sendrecv(-1, nullptr, 0, from, in, bytes); }
+
+  enum reduce_op { sum, min, max };
+  // element-wise reduction over all ranks, every rank gets the result
+  void allreduce(std::vector<uint64_t> &values, const reduce_op &op);
+  void barrier();
+};
+
+// kind is "shm", "unix" or "tcp"; ranks of one run share the session name
+std::unique_ptr<transport> make_transport(const std::string &kind, const int &rank, const int &size,
+                                          const std::string &session, const int &port = 47000);
+
+#endif // TRANSPORT_HPP
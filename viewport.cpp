@@ -0,0 +1,45 @@
+#include <algorithm>
+
+#include "viewport.hpp"
+
+viewport::viewport(const int &screen_w, const int &screen_h, const int &world_w, const int &world_h)
+  : screen_w(screen_w),
+    screen_h(screen_h),
+    world_w(world_w),
+    world_h(world_h),
+    x(0),
+    y(0),
+    zoom(1),
+    min_zoom(std::min((double)screen_w/world_w, (double)screen_h/world_h)),
+    max_zoom(std::max(64.0, min_zoom))
+{
+  fit();
+}
+
+void viewport::fit() {
+  zoom = min_zoom;
+  clamp();
+}
+
+void viewport::zoom_at(const double &factor, const int &sx, const int &sy) {
+  const double wx = world_x(sx), wy = world_y(sy);
+  zoom = std::max(min_zoom, std::min(max_zoom, zoom*factor));
+  x = wx - sx/zoom;
+  y = wy - sy/zoom;
+  clamp();
+}
+
+void viewport::pan(const double &dx, const double &dy) {
+  x -= dx/zoom;
+  y -= dy/zoom;
+  clamp();
+}
+
+// center along an axis the world doesn't fill, otherwise keep it on screen
+void viewport::clamp() {
+  const double view_w = screen_w/zoom, view_h = screen_h/zoom;
+  if(view_w >= world_w) x = (world_w - view_w)/2;
+  else x = std::max(0.0, std::min(world_w - view_w, x));
+  if(view_h >= world_h) y = (world_h - view_h)/2;
+  else y = std::max(0.0, std::min(world_h - view_h, y));
+}
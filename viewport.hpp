@@ -0,0 +1,42 @@
+#ifndef VIEWPORT_HPP
+#define VIEWPORT_HPP
+
+// Maps screen pixels to world cells. The view can't zoom out further
+// than showing the whole world and always stays over the world.
+class viewport
+{
+public:
+  int screen_w;
+  int screen_h;
+  int world_w;
+  int world_h;
+  // world position of the top-left screen corner, in cells
+  double x;
+  double y;
+  // screen pixels per cell
+  double zoom;
+  double min_zoom;
+  double max_zoom;
+
+public:
+  viewport(const int &screen_w = 1, const int &screen_h = 1, const int &world_w = 1, const int &world_h = 1);
+
+  void fit();
+  void zoom_at(const double &factor, const int &sx, const int &sy);
+  void pan(const double &dx, const double &dy);
+  double cells_per_pixel() const { return 1/zoom; }
+  double world_x(const double &sx) const { return x + sx/zoom; }
+  double world_y(const double &sy) const { return y + sy/zoom; }
+  double screen_x(const double &wx) const { return (wx - x)*zoom; }
+  double screen_y(const double &wy) const { return (wy - y)*zoom; }
+
+  bool operator==(const viewport &o) const {
+    return x == o.x && y == o.y && zoom == o.zoom;
+  }
+  bool operator!=(const viewport &o) const { return !(*this == o); }
+
+private:
+  void clamp();
+};
+
+#endif // VIEWPORT_HPP
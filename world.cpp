@@ -1,14 +1,22 @@
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <future>
 #include <iostream>
 #include <random>
+#include <stdexcept>
 
 #include <boost/range/irange.hpp>
 #include <boost/range/algorithm/for_each.hpp>
 
 #include "world.hpp"
 #include "random.hpp"
+#include "numa.hpp"
+#include "tracer.hpp"
+#include "bitrow.hpp"
 
 
 world::world(const int &width, const int &height, const int &threads)
@@ -17,28 +25,79 @@ world::world(const int &width, const int &height, const int &threads)
     cellsEqualGenerations(0),
     lastGenEqual(false),
     generation(0),
-    pool(threads)
+    seed(random_seed()),
+    density(17),
+    reseeds(0),
+    pool(threads),
+    segments_per_row((width+segment_width-1)/segment_width),
+    changed_segments(segments_per_row*height, 1),
+    last_changed_segments(segments_per_row*height, 1),
+    dirty_segments(segments_per_row*height, 1),
+    row_listed(height, 0),
+    column_parts(width, threads),
+    row_parts(height, threads),
+    boundary("torus"),
+    padded((size_t)(width+3)*(height+3), cell{false}),
+    padded_height(height+3),
+    live_columns(width, 0),
+    live_rows(threads, std::vector<char>(height, 0)),
+    edge_flags(threads),
+    edge_segments(threads),
+    kernel("auto"),
+    cells_stale(false),
+    target_generation(-1),
+    cycle_period(0),
+    cycle_start(0),
+    cycle_check(-1),
+    jumped_from(-1),
+    checkpoint_every(0),
+    checkpoint_dir("."),
+    numa_placement(false),
+    huge_pages(false),
+    unrecorded(true)
 {
-  random_gen r(0,5);
-  for(auto x : boost::irange(0, width)) {
-    cell_vector row;
-    for(auto y : boost::irange(0, height)) {
-      row.push_back(cell{(r.get() == 1)});
-    }
-    cells.push_back(row);
+  for(auto y : boost::irange(0, height)) {
+    changed_rows.push_back(y);
+    mark_dirty_row(y);
   }
-  last_last_gen = cells;
-  last_gen = cells;
+  last_changed_rows = changed_rows;
+  cells.assign(width, cell_vector(height, cell{false}));
+  last_gen = last_last_gen = cells;
+  uncrop();
+  set_rule(rules::conway);
+  seed_life();
+}
+
+void world::set_seed(const uint64_t &seed, const int &percent) {
+  this->seed = seed;
+  density = percent;
+  reseeds = 0;
 }
 
 void world::seed_life(const bool random) {
   if(random) {
-    random_gen r(0,5);
-    for(auto &col : cells) {
-      for(auto &cell : col) {
-        cell.alive = (r.get() == 1);
-      }
+    // Column ranges of whole 64-cell words per worker, so every worker
+    // writes its own columns; the bits only depend on seed and position.
+    const bulk_random bulk(bulk_random::board_seed(seed, reseeds++), density);
+    std::vector<uint64_t> streams(height);
+    for(auto y : boost::irange(0, height)) streams[y] = bulk.stream(y);
+    int const workers = (int)pool.workers.size();
+    int const words = (width+63)/64;
+    for(auto worker : boost::irange(0, workers)) {
+      int const from = words*worker/workers, to = words*(worker+1)/workers;
+      if(from >= to) continue;
+      results.emplace_back(pool.enqueue([this, &bulk, &streams, from, to] {
+        for(int word = from; word < to; word++) {
+          const int x = word*64, n = std::min(64, width-x);
+          for(auto y : boost::irange(0, height)) {
+            const uint64_t bits = bulk.cells(streams[y], word);
+            for(int b = 0; b < n; b++) cells[x+b][y].alive = (bits >> b) & 1;
+          }
+        }
+      }));
     }
+    boost::for_each(results, [] (auto &t) { t.wait(); });
+    results.clear();
   }
   else {
     for(auto &col : cells) {
@@ -49,6 +108,8 @@ void world::seed_life(const bool random) {
   }
   last_last_gen = cells;
   last_gen = cells;
+  import_cells();
+  mark_dirty();
 }
 
 void world::seed_life(cell_grid &seed) {
@@ -57,39 +118,29 @@ void world::seed_life(cell_grid &seed) {
       cells[x][y].alive = seed[x][y].alive;
     }
   }
+  import_cells();
+  mark_dirty();
 }
 
 void world::next_generation() {
-  last_last_gen = last_gen;
-  last_gen = cells;
-  std::vector<std::thread> threads;
-
-  auto w_range = boost::irange(0, width);
-  auto h_range = boost::irange(0, height);
-  auto workers = boost::irange(0, (int)pool.workers.size());
-  auto worker_load = cells.size()/pool.workers.size();
-
-  boost::for_each(workers, [this, &threads, &worker_load, w_range, h_range] (int worker) {
-      auto start_w = worker*worker_load;
-      results.emplace_back(pool.enqueue([this, start_w, worker, worker_load, w_range, h_range] {
-        std::for_each(w_range.begin()+start_w, w_range.begin()+start_w+worker_load, [this, h_range] (int x) {
-            boost::for_each(h_range, [&] (int y) {
-                evolution(x, y);
-            });
-        });
-      }));
-  });
-
-  boost::for_each(results, [] (auto &t) { t.wait(); });
-
+  apply_edits();
+  if(unrecorded) remember();
+  // a fixed board steps in well under a microsecond, where the clock
+  // reads of a trace would be the larger part
+  const bool traced = !fixed;
+  {
+    trace_scope scope("step", "phase", traced);
+    advance();
+  }
   generation++;
-  bool allCellsEqual = false;
-  for(auto x : w_range) {
-    for(auto y : h_range) {
-      allCellsEqual = cells[x][y].alive == last_last_gen[x][y].alive;
-      if(!allCellsEqual) break;
-    }
-    if(!allCellsEqual) break;
+  if(target_generation > generation) skip_cycle();
+  if(checkpoint_every > 0 && generation % checkpoint_every == 0) checkpoint();
+  remember();
+
+  bool allCellsEqual;
+  {
+    trace_scope scope("stability check", "phase", traced);
+    allCellsEqual = same_as_two_generations_ago();
   }
 
   if(lastGenEqual && allCellsEqual) {
@@ -105,104 +156,1171 @@ void world::next_generation() {
   lastGenEqual = allCellsEqual;
 }
 
-void world::evolution(const int &x, const int &y) {
-  int n = neighbours(x,y);
-  cell &c = cells[x][y];
-  if(c.alive) {
-    c.alive = (n == 2 || n == 3);
+// one step of the board, without the bookkeeping of next_generation
+void world::advance() {
+  changed_segments.swap(last_changed_segments);
+  changed_rows.swap(last_changed_rows);
+  for(auto y : changed_rows) {
+    std::fill_n(&changed_segments[(size_t)y*segments_per_row], segments_per_row, 0);
+  }
+  changed_rows.clear();
+
+  if(multi_state()) {
+    step_states();
+  }
+  else if(fixed) {
+    step_fixed();
   }
   else {
-    c.alive = (n == 3);
+    step_cells();
   }
+
+  // a segment needs repainting if it changed now or in the previous step,
+  // since dying cells are drawn from last_gen as well
+  auto merge = [this] (const std::vector<char> &flags, const std::vector<int> &rows) {
+    for(auto y : rows) {
+      const char *changed = &flags[(size_t)y*segments_per_row];
+      char *dirty = &dirty_segments[(size_t)y*segments_per_row];
+      for(int s = 0; s < segments_per_row; s++) dirty[s] |= changed[s];
+      mark_dirty_row(y);
+    }
+  };
+  merge(changed_segments, changed_rows);
+  merge(last_changed_segments, last_changed_rows);
 }
 
-void world::dump_generation() {
-  last_dump = get_timestamp();
-  random_gen r(1000000,9999999);
-  last_dump_str = std::to_string(r.get())+"_"+std::to_string(last_dump);
-  std::ofstream dump("dump_"+last_dump_str+".gol", std::ios::binary );
-  for(auto &col : cells) {
-    for(auto &cell : col) {
-      dump.write(reinterpret_cast<const char*>(&cell.alive), sizeof(cell.alive));
+// lists the rows in [from_y, to_y) that have a flag in changed_segments
+void world::note_changed_rows(const int &from_y, const int &to_y) {
+  for(int y = from_y; y < to_y; y++) {
+    const char *row = &changed_segments[(size_t)y*segments_per_row];
+    if(std::find(row, row+segments_per_row, 1) != row+segments_per_row) changed_rows.push_back(y);
+  }
+}
+
+// Remembers a hash of every recent generation. Once one comes back the
+// board may be in a cycle of period p. The board is kept and compared
+// with the one p generations later, so a hash collision can't jump to a
+// wrong board; once they match, the state at target_generation is the
+// one (target - generation) mod p steps ahead, so only those steps are
+// run. Cycles of period 1 and 2 are stepped instead: next_generation
+// reseeds such boards after 20 generations, which a jump would skip.
+void world::skip_cycle() {
+  if(cycle_check >= 0) {
+    if(generation < cycle_check) return;
+    cycle_check = -1;
+    pack_board(cycle_next);
+    if(cycle_next == cycle_board) {
+      jumped_from = generation;
+      const int phase = (target_generation - generation) % cycle_period;
+      for(int i = 0; i < phase; i++) advance();
+      generation = target_generation;
+      forget_cycles();
+      return;
+    }
+  }
+
+  const uint64_t h = state_hash();
+  auto const seen = seen_states.find(h);
+  if(seen == seen_states.end() || generation - seen->second <= 2) {
+    seen_states[h] = generation;
+    seen_order.push_back(h);
+    if((int)seen_order.size() > cycle_window) {
+      seen_states.erase(seen_order.front());
+      seen_order.pop_front();
     }
+    return;
   }
+
+  cycle_start = seen->second;
+  cycle_period = generation - cycle_start;
+  cycle_check = generation + cycle_period;
+  pack_board(cycle_board);
 }
 
-void world::load_generation(std::string filename, bool isBinary) {
-  if(isBinary) {
-    std::ifstream dump(filename, std::ios::binary);
-    if(dump) {
-      std::string alive_str;
-      bool alive;
-      for(auto &col : cells) {
-        for(auto &cell : col) {
-          dump.read(&*alive_str.begin(), sizeof(alive));
-          alive = static_cast<bool>(alive_str[0]);
-          cell.alive = alive;
+void world::forget_cycles() {
+  seen_states.clear();
+  seen_order.clear();
+  cycle_check = -1;
+}
+
+uint64_t world::state_hash() {
+  uint64_t h = 0x84222325CBF29CE4ull;
+  auto add = [&h] (const uint64_t &w) {
+    h = (h ^ w) * 0x100000001B3ull;
+    h ^= h >> 29;
+  };
+  if(fixed) return fixed->hash();
+  if(multi_state()) {
+    for(auto w : states.bits) add(w);
+    return h;
+  }
+  for(auto const &col : cells) {
+    static_assert(sizeof(cell) == 1, "cells are hashed as bytes");
+    size_t y = 0;
+    for(; y+8 <= col.size(); y += 8) {
+      uint64_t w;
+      std::memcpy(&w, &col[y], 8);
+      add(w);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, col.data()+y, col.size()-y);
+    add(tail);
+  }
+  return h;
+}
+
+// Only the live boxes are copied and stepped; outside them every
+// generation is dead, so there is nothing to do.
+void world::step_cells() {
+  const bool crop_live = !(life_rule.birth & 1);
+  crop_box copy{crop::whole(width), crop::whole(height)}, step = copy;
+  if(crop_live) {
+    copy.x = crop::join(crop::join(live[0].x, live[1].x, width), live[2].x, width);
+    copy.y = crop::join(crop::join(live[0].y, live[1].y, height), live[2].y, height);
+    step.x = crop::grow(live[0].x, width, 1);
+    step.y = crop::grow(live[0].y, height, 1);
+    // the top and bottom edges of a klein bottle meet mirrored
+    if(boundary == "klein" && crop::touches_edge(step.y, height)) step.x = crop::whole(width);
+  }
+
+  std::vector< std::pair<int,int> > columns, rows;
+  crop::pieces(copy.x, width, columns);
+  crop::pieces(copy.y, height, rows);
+  for(auto const &c : columns) {
+    for(int x = c.first; x < c.second; x++) {
+      for(auto const &r : rows) {
+        std::memcpy(&last_last_gen[x][r.first], &last_gen[x][r.first], (r.second-r.first)*sizeof(cell));
+        std::memcpy(&last_gen[x][r.first], &cells[x][r.first], (r.second-r.first)*sizeof(cell));
+      }
+    }
+  }
+
+  crop::pieces(step.x, width, columns);
+  crop::pieces(step.y, height, step_rows);
+  for(auto const &c : columns) {
+    for(auto const &r : step_rows) fill_halo(c.first-1, c.second+1, r.first-1, r.second+1);
+  }
+
+  // A whole board is split by column_range, a cropped one by the
+  // balancer's costs of the columns it steps. Either way the workers'
+  // times over the columns they stepped feed the balancer, scaled to the
+  // whole height so that crops of any height compare.
+  int const workers = (int)pool.workers.size();
+  const bool whole = step.x.full(width) && step.y.full(height);
+  std::vector<balancer::ranges> ranges(workers);
+  if(whole) {
+    for(auto worker : boost::irange(0, workers)) {
+      int from_x, to_x;
+      column_range(worker, from_x, to_x);
+      if(from_x < to_x) ranges[worker].emplace_back(from_x, to_x);
+    }
+  }
+  else {
+    column_parts.split(columns, ranges);
+  }
+  int stepped_rows = 0;
+  for(auto const &r : step_rows) stepped_rows += r.second - r.first;
+  const double scale = stepped_rows ? (double)height/stepped_rows : 1;
+
+  // Ranges are cut at any column, so a segment may be stepped by more
+  // than one worker. Each of them flags such a segment in a column of its
+  // own in edge_flags, merged into changed_segments afterwards; a segment
+  // of one worker only is flagged in place.
+  std::vector<int> owner(segments_per_row, -1);
+  for(auto worker : boost::irange(0, workers)) {
+    for(auto const &r : ranges[worker]) {
+      for(int s = r.first/segment_width; s <= (r.second-1)/segment_width; s++) {
+        owner[s] = owner[s] == -1 || owner[s] == worker ? worker : -2;
+      }
+    }
+  }
+  std::vector< std::vector<column_run> > runs(workers);
+  for(auto worker : boost::irange(0, workers)) {
+    auto &segments = edge_segments[worker];
+    segments.clear();
+    for(auto const &r : ranges[worker]) {
+      for(int s = r.first/segment_width; s <= (r.second-1)/segment_width; s++) {
+        if(owner[s] == -2) segments.push_back(s);
+      }
+    }
+    edge_flags[worker].assign(segments.size()*height, 0);
+    size_t edge = 0;
+    for(auto const &r : ranges[worker]) {
+      for(int x = r.first; x < r.second; ) {
+        const int s = x/segment_width;
+        const int to_x = std::min(r.second, (s+1)*segment_width);
+        auto &own = runs[worker];
+        if(owner[s] == -2) {
+          own.push_back(column_run{x, to_x, &edge_flags[worker][edge++*height], 1});
         }
+        else if(!own.empty() && own.back().to_x == x && own.back().stride == segments_per_row) {
+          own.back().to_x = to_x;
+        }
+        else {
+          own.push_back(column_run{x, to_x, &changed_segments[s], segments_per_row});
+        }
+        x = to_x;
       }
     }
   }
+
+  if(crop_live) {
+    std::fill(live_columns.begin(), live_columns.end(), 0);
+    for(auto &r : live_rows) std::fill(r.begin(), r.end(), 0);
+  }
+
+  // see column_range and run_partition
+  boost::for_each(boost::irange(0, workers), [&] (int worker) {
+      if(ranges[worker].empty()) return;
+      results.emplace_back(run_partition(worker, [this, worker, scale, crop_live, &ranges, &runs] {
+        auto const start = std::chrono::steady_clock::now();
+        for(auto const &r : runs[worker]) (this->*step_columns)(r.from_x, r.to_x, r.changed, r.stride);
+        auto const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        column_parts.measured(worker, seconds*scale, ranges[worker]);
+        if(!crop_live) return;
+        char *rows_live = live_rows[worker].data();
+        for(auto const &r : ranges[worker]) {
+          for(int x = r.first; x < r.second; x++) {
+            const cell *col = cells[x].data();
+            char any = 0;
+            for(auto const &rows : step_rows) {
+              for(int y = rows.first; y < rows.second; y++) {
+                const char alive = col[y].alive;
+                rows_live[y] |= alive;
+                any |= alive;
+              }
+            }
+            live_columns[x] = any;
+          }
+        }
+      }));
+  });
+
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+  column_parts.rebalance();
+  for(auto worker : boost::irange(0, workers)) {
+    for(size_t edge = 0; edge < edge_segments[worker].size(); edge++) {
+      const char *flags = &edge_flags[worker][edge*height];
+      char *changed = &changed_segments[edge_segments[worker][edge]];
+      for(auto const &rows : step_rows) {
+        for(int y = rows.first; y < rows.second; y++) changed[y*segments_per_row] |= flags[y];
+      }
+    }
+  }
+  for(auto const &rows : step_rows) note_changed_rows(rows.first, rows.second);
+
+  live[2] = live[1];
+  live[1] = live[0];
+  if(crop_live) {
+    for(size_t w = 1; w < live_rows.size(); w++) {
+      for(int y = 0; y < height; y++) live_rows[0][y] |= live_rows[w][y];
+    }
+    live[0] = crop_box{crop::cover(live_columns), crop::cover(live_rows[0])};
+  }
+}
+
+void world::uncrop() {
+  for(auto &box : live) box = crop_box{crop::whole(width), crop::whole(height)};
+}
+
+// cells in the w x h rectangle at (x,y) may have come alive
+void world::add_live(const int &x, const int &y, const int &w, const int &h) {
+  const span xs{((x % width) + width) % width, std::min(w, width)};
+  const span ys{((y % height) + height) % height, std::min(h, height)};
+  live[0].x = crop::join(live[0].x, xs, width);
+  live[0].y = crop::join(live[0].y, ys, height);
+}
+
+void world::step_fixed() {
+  const uint64_t rows = fixed->step();
+  for(auto y : boost::irange(0, height)) {
+    if((rows >> y) & 1) {
+      changed_segments[y*segments_per_row] = 1;
+      changed_rows.push_back(y);
+    }
+  }
+  cells_stale = true;
+}
+
+void world::sync_cells() {
+  if(!cells_stale) return;
+  fixed->store(cells, last_gen);
+  cells_stale = false;
+}
+
+void world::step_states() {
+  // rotate buffers instead of copying, every row of states is rewritten
+  std::swap(last_last_states, last_states);
+  std::swap(last_states, states);
+
+  boost::for_each(boost::irange(0, (int)pool.workers.size()), [this] (int worker) {
+      int start_y, end_y;
+      row_range(worker, start_y, end_y);
+      if(start_y >= end_y) return;
+      results.emplace_back(run_partition(worker, [this, worker, start_y, end_y] {
+        auto const start = std::chrono::steady_clock::now();
+        step_generations(last_states, states, life_rule, start_y, end_y, changed_segments);
+        row_parts.measured(worker, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }));
+  });
+
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+  row_parts.rebalance();
+  note_changed_rows(0, height);
+}
+
+// column ranges of the balancer, cut at any column
+void world::column_range(const int &worker, int &from_x, int &to_x) const {
+  from_x = column_parts.from(worker);
+  to_x = column_parts.to(worker);
+}
+
+void world::row_range(const int &worker, int &from_y, int &to_y) const {
+  from_y = row_parts.from(worker);
+  to_y = row_parts.to(worker);
+}
+
+// Binds worker i to the i-th online cpu, filling one node before the next
+// so that neighbouring partitions share a node.
+void world::pin_workers() {
+  auto const cpus = numa::online_cpus();
+  worker_nodes.clear();
+  for(auto worker : boost::irange(0, (int)pool.workers.size())) {
+    auto const &c = cpus[worker % cpus.size()];
+    worker_nodes.push_back(numa::pin(pool.workers[worker], c.id) ? c.node : -1);
+  }
+}
+
+// Transparent huge pages for the grids where they lie now; columns
+// shorter than a huge page don't get any.
+void world::advise_huge_pages() {
+  if(multi_state()) {
+    for(auto grid : {&states, &last_states, &last_last_states}) {
+      numa::advise_huge(grid->bits.data(), grid->bits.size()*sizeof(uint64_t));
+    }
+  }
+  for(auto grid : {&cells, &last_gen, &last_last_gen}) {
+    for(auto &col : *grid) numa::advise_huge(col.data(), col.size()*sizeof(cell));
+  }
+  numa::advise_huge(padded.data(), padded.size()*sizeof(cell));
+}
+
+// Reallocates each worker's columns, or touches its rows of the state
+// planes, from that worker, so first touch puts them on its node.
+void world::place_partitions() {
+  // the pages follow the partitions, so from here on they stay put
+  column_parts.adaptive = false;
+  row_parts.adaptive = false;
+  if(multi_state() && huge_pages) {
+    for(auto grid : {&states, &last_states, &last_last_states}) {
+      numa::advise_huge(grid->bits.data(), grid->bits.size()*sizeof(uint64_t));
+    }
+  }
+  boost::for_each(boost::irange(0, (int)pool.workers.size()), [this] (int worker) {
+      results.emplace_back(pool.enqueue_to(worker, [this, worker] {
+        if(multi_state()) {
+          int from_y, to_y;
+          row_range(worker, from_y, to_y);
+          if(from_y >= to_y) return;
+          for(auto grid : {&states, &last_states, &last_last_states}) {
+            auto const bytes = (size_t)(to_y-from_y)*grid->planes*grid->words*sizeof(uint64_t);
+            numa::touch_here(grid->plane(from_y, 0), bytes);
+          }
+          return;
+        }
+        int from_x, to_x;
+        column_range(worker, from_x, to_x);
+        for(auto grid : {&cells, &last_gen, &last_last_gen}) {
+          for(auto x : boost::irange(from_x, to_x)) {
+            cell_vector fresh;
+            fresh.reserve(height);
+            if(huge_pages) numa::advise_huge(fresh.data(), height*sizeof(cell));
+            fresh.assign((*grid)[x].begin(), (*grid)[x].end());
+            (*grid)[x].swap(fresh);
+          }
+        }
+      }));
+  });
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+}
+
+// share of the grid on another node than the worker stepping it, by the
+// node of the pages each partition's bytes lie on
+std::string world::numa_report() {
+  if(worker_nodes.empty()) return "numa: workers not pinned";
+  double bytes = 0, remote = 0;
+  std::vector<int> nodes;
+  auto count = [&] (const void *p, const size_t &n, const int &node) {
+    if(!numa::page_nodes(p, n, nodes)) return false;
+    size_t known = 0, away = 0;
+    for(auto page_node : nodes) {
+      if(page_node < 0) continue;
+      known++;
+      if(page_node != node) away++;
+    }
+    if(known) {
+      bytes += n;
+      remote += (double)n*away/known;
+    }
+    return true;
+  };
+  for(auto worker : boost::irange(0, (int)pool.workers.size())) {
+    const int node = worker_nodes[worker];
+    if(multi_state()) {
+      int from_y, to_y;
+      row_range(worker, from_y, to_y);
+      if(from_y >= to_y) continue;
+      auto const n = (size_t)(to_y-from_y)*states.planes*states.words*sizeof(uint64_t);
+      if(!count(states.plane(from_y, 0), n, node)) return "numa: page nodes unavailable";
+      continue;
+    }
+    int from_x, to_x;
+    column_range(worker, from_x, to_x);
+    for(auto x : boost::irange(from_x, to_x)) {
+      if(!count(cells[x].data(), height*sizeof(cell), node)) return "numa: page nodes unavailable";
+    }
+  }
+  auto const percent = bytes > 0 ? (int)(100*remote/bytes + 0.5) : 0;
+  return "remote: " + std::to_string(percent) + "%";
+}
+
+bool world::same_as_two_generations_ago() {
+  if(fixed) return fixed->same_as_two_generations_ago();
+  if(multi_state()) {
+    for(auto y : boost::irange(0, height)) {
+      if(!states.row_equal(last_last_states, y)) return false;
+    }
+    return true;
+  }
+
+  // outside both boxes both generations are dead
+  std::vector< std::pair<int,int> > columns, rows;
+  crop::pieces(crop::join(live[0].x, live[2].x, width), width, columns);
+  crop::pieces(crop::join(live[0].y, live[2].y, height), height, rows);
+  for(auto const &c : columns) {
+    for(int x = c.first; x < c.second; x++) {
+      for(auto const &r : rows) {
+        if(std::memcmp(&cells[x][r.first], &last_last_gen[x][r.first], (r.second-r.first)*sizeof(cell))) return false;
+      }
+    }
+  }
+  return true;
+}
+
+int world::cell_state(const int &x, const int &y) const {
+  if(multi_state()) return states.get(x, y);
+  return cells[x][y].alive;
+}
+
+// live cells in the two-state grid become state 1, everything else dead
+void world::import_cells() {
+  uncrop();
+  unrecorded = true;
+  forget_cycles();
+  if(fixed) {
+    fixed->load(cells, last_gen);
+    cells_stale = false;
+  }
+  if(!multi_state()) return;
+  states = state_planes(width, height, life_rule.states);
+  for(auto x : boost::irange(0, width)) {
+    for(auto y : boost::irange(0, height)) {
+      if(cells[x][y].alive) states.set(x, y, 1);
+    }
+  }
+  last_states = states;
+  last_last_states = states;
+  if(numa_placement) place_partitions();
+  else if(huge_pages) advise_huge_pages();
+}
+
+void world::set_rule(const rule &r) {
+  life_rule = r;
+  for(int n = 0; n <= 8; n++) {
+    rule_table[n] = (r.birth >> n) & 1;
+    rule_table[9+n] = (r.survive >> n) & 1;
+  }
+  choose_kernel();
+
+  // frames of another rule are packed differently
+  rewind.clear();
+  import_cells();
+  mark_dirty();
+}
+
+// "auto" folds common rules into a kernel at compile time and uses the
+// neighbour count table for the rest, "table" always uses that table and
+// "block" steps 2x2 blocks through block_table.
+void world::set_kernel(const std::string &name) {
+  if(name != "auto" && name != "table" && name != "block") {
+    throw std::invalid_argument("unknown kernel '" + name + "', expected auto, table or block");
+  }
+  kernel = name;
+  choose_kernel();
+}
+
+// "adaptive" moves the partition bounds every generation so each worker
+// gets the same measured stepping time, "even" keeps equal sized parts.
+void world::set_partitioning(const std::string &name) {
+  if(name != "adaptive" && name != "even") {
+    throw std::invalid_argument("unknown partitioning '" + name + "', expected adaptive or even");
+  }
+  column_parts.adaptive = row_parts.adaptive = name == "adaptive";
+  if(!column_parts.adaptive) {
+    column_parts.reset(width, column_parts.parts());
+    row_parts.reset(height, row_parts.parts());
+  }
+}
+
+void world::set_boundary(const std::string &name) {
+  if(name != "torus" && name != "dead" && name != "cylinder" && name != "klein") {
+    throw std::invalid_argument("unknown boundary '" + name + "', expected torus, dead, cylinder or klein");
+  }
+  if(multi_state() && name != "torus") {
+    throw std::invalid_argument("rules with more than two states only run on a torus");
+  }
+  boundary = name;
+  choose_kernel();
+  forget_cycles();
+}
+
+// Copies the rectangle [from_x, to_x) x [from_y, to_y) of last_gen into
+// padded, where -1 and width or height are ghost cells. A ghost is
+// mapped back onto the board rows first, the way the boundary joins top
+// and bottom, then columns, so corners come out right for every topology.
+void world::fill_halo(const int &from_x, const int &to_x, const int &from_y, const int &to_y) {
+  const bool wrap_x = boundary != "dead";
+  const bool torus = boundary == "torus";
+  const bool klein = boundary == "klein";
+  auto ghost = [&] (int x, int y) {
+    if(y < 0 || y >= height) {
+      if(!torus && !klein) return cell{false};
+      y = (y+height) % height;
+      if(klein) x = width-1-x;
+    }
+    if(x < 0 || x >= width) {
+      if(!wrap_x) return cell{false};
+      x = (x+width) % width;
+    }
+    return last_gen[x][y];
+  };
+  for(int x = from_x; x < to_x; x++) {
+    cell *col = &padded[(size_t)(x+1)*padded_height + 1];
+    if(x < 0 || x >= width) {
+      for(int y = from_y; y < to_y; y++) col[y] = ghost(x, y);
+      continue;
+    }
+    const int y0 = std::max(from_y, 0), y1 = std::min(to_y, height);
+    if(y0 < y1) std::memcpy(col+y0, last_gen[x].data()+y0, (y1-y0)*sizeof(cell));
+    if(from_y < 0) col[-1] = ghost(x, -1);
+    if(to_y > height) col[height] = ghost(x, height);
+  }
+}
+
+void world::choose_kernel() {
+  const rule &r = life_rule;
+  sync_cells();
+  // the fixed board did not keep the live boxes
+  if(fixed) uncrop();
+  fixed.reset();
+  // fixed boards are tori
+  if(kernel == "auto" && boundary == "torus") {
+    fixed = make_fixed_board(width, height, r);
+    if(fixed) fixed->load(cells, last_gen);
+  }
+
+  if(kernel == "block") {
+    block_table.resize(1 << 16);
+    for(int index = 0; index < (1 << 16); index++) {
+      unsigned char out = 0;
+      for(int oy = 0; oy < 2; oy++) {
+        for(int ox = 0; ox < 2; ox++) {
+          int n = 0;
+          for(int dy = -1; dy <= 1; dy++) {
+            for(int dx = -1; dx <= 1; dx++) {
+              if(dx || dy) n += (index >> ((1+oy+dy)*4 + 1+ox+dx)) & 1;
+            }
+          }
+          const bool alive = (index >> ((1+oy)*4 + 1+ox)) & 1;
+          if(rule_table[alive*9 + n]) out |= 1 << (oy*2 + ox);
+        }
+      }
+      block_table[index] = out;
+    }
+    step_columns = &world::step_blocks;
+    return;
+  }
+  if(kernel == "table") {
+    step_columns = &world::step_table;
+    return;
+  }
+
+  // common rules get a kernel with the rule folded in at compile time
+  auto is = [&r] (const rule &known) {
+    return r == known;
+  };
+  if(is(rules::conway))
+    step_columns = &world::step_rule<rules::conway.birth, rules::conway.survive>;
+  else if(is(rules::highlife))
+    step_columns = &world::step_rule<rules::highlife.birth, rules::highlife.survive>;
+  else if(is(rules::day_and_night))
+    step_columns = &world::step_rule<rules::day_and_night.birth, rules::day_and_night.survive>;
+  else if(is(rules::seeds))
+    step_columns = &world::step_rule<rules::seeds.birth, rules::seeds.survive>;
+  else if(is(rules::life_without_death))
+    step_columns = &world::step_rule<rules::life_without_death.birth, rules::life_without_death.survive>;
+  else
+    step_columns = &world::step_table;
+}
+
+// The boundary lives in the ghost cells of padded, so the kernels read
+// neighbours at fixed offsets without any wrap checks.
+template<unsigned Birth, unsigned Survive>
+void world::step_rule(const int &from_x, const int &to_x, char *changed, const int &stride) {
+  for(int x = from_x; x < to_x; x++) {
+    char *flags = changed + (x/segment_width - from_x/segment_width);
+    const cell *src = halo_column(x);
+    cell *out = cells[x].data();
+    for(auto const &rows : step_rows) {
+      for(int y = rows.first; y < rows.second; y++) {
+        if(evolution<Birth, Survive>(out[y], neighbours(src+y))) flags[y*stride] = 1;
+      }
+    }
+  }
+}
+
+void world::step_table(const int &from_x, const int &to_x, char *changed, const int &stride) {
+  for(int x = from_x; x < to_x; x++) {
+    char *flags = changed + (x/segment_width - from_x/segment_width);
+    const cell *src = halo_column(x);
+    cell *out = cells[x].data();
+    for(auto const &rows : step_rows) {
+      for(int y = rows.first; y < rows.second; y++) {
+        if(evolution_table(out[y], neighbours(src+y))) flags[y*stride] = 1;
+      }
+    }
+  }
+}
+
+// Two columns at a time; going down, the 4x4 window drops its top two
+// rows and takes in two new ones, so each lookup reads only 8 new cells.
+void world::step_blocks(const int &from_x, const int &to_x, char *changed, const int &stride) {
+  for(int x = from_x; x < to_x; x += 2) {
+    // columns x-1 to x+2 of padded, past the ghost column only zeros
+    const cell *col[4];
+    for(int i = 0; i < 4; i++) col[i] = halo_column(x-1+i);
+    auto nibble = [&col] (const int &y) {
+      return col[0][y].alive | col[1][y].alive << 1 | col[2][y].alive << 2 | col[3][y].alive << 3;
+    };
+    const bool pair = x+1 < to_x;
+    cell *out0 = cells[x].data();
+    cell *out1 = pair ? cells[x+1].data() : nullptr;
+    // x+1 may start the next segment when from_x is odd
+    char *flags0 = changed + (x/segment_width - from_x/segment_width);
+    char *flags1 = changed + ((x+1)/segment_width - from_x/segment_width);
+    const unsigned columns = pair ? 15 : 5;
+
+    for(auto const &rows : step_rows) {
+      const int from_y = rows.first, to_y = rows.second;
+      unsigned index = nibble(from_y-1) << 8 | nibble(from_y) << 12;
+      for(int y = from_y; y < to_y; y += 2) {
+        index = index >> 8 | nibble(y+1) << 8 | nibble(y+2) << 12;
+        const unsigned next = block_table[index];
+        // the inner 2x2 of the window is what the block was
+        const unsigned was = (index >> 5 & 3) | (index >> 7 & 12);
+        const unsigned diff = (next ^ was) & columns;
+        out0[y].alive = next & 1;
+        if(pair) out1[y].alive = next >> 1 & 1;
+        if(y+1 < to_y) {
+          out0[y+1].alive = next >> 2 & 1;
+          if(pair) out1[y+1].alive = next >> 3 & 1;
+        }
+        if(!diff) continue;
+        if(diff & 1) flags0[y*stride] = 1;
+        if(diff & 2) flags1[y*stride] = 1;
+        if(y+1 < to_y) {
+          if(diff & 4) flags0[(y+1)*stride] = 1;
+          if(diff & 8) flags1[(y+1)*stride] = 1;
+        }
+      }
+    }
+  }
+}
+
+template<unsigned Birth, unsigned Survive>
+bool world::evolution(cell &c, const int &n) {
+  const bool was_alive = c.alive;
+  if(c.alive) {
+    c.alive = (Survive >> n) & 1;
+  }
   else {
-    std::ifstream dump(filename, std::ios::binary);
-    if(dump) {
-      for(auto y : boost::irange(0, height)) {
-        for(auto x : boost::irange(0, width)) {
-          char alive_char;
-          dump.read(&alive_char, 1);
-          if(alive_char == '\n') dump.read(&alive_char, 1);
-          cells[x][y].alive = alive_char == '0';
+    c.alive = (Birth >> n) & 1;
+  }
+  return c.alive != was_alive;
+}
+
+bool world::evolution_table(cell &c, const int &n) {
+  const bool was_alive = c.alive;
+  c.alive = rule_table[was_alive*9 + n];
+  return c.alive != was_alive;
+}
+
+// Runs on the thread that steps, so edits never land in the middle of a
+// generation.
+void world::apply_edits() {
+  if(edits.empty()) return;
+  edits.take(edit_batch);
+  sync_cells();
+  for(auto const &e : edit_batch) {
+    if(e.kind == edit::paste) {
+      paste(*e.pattern, e.x0, e.y0);
+      add_live(e.x0, e.y0, e.pattern->width, e.pattern->height);
+      continue;
+    }
+    add_live(std::min(e.x0, e.x1), std::min(e.y0, e.y1), std::abs(e.x1-e.x0)+1, std::abs(e.y1-e.y0)+1);
+    // Bresenham, so a fast drag leaves no gaps
+    int x = e.x0, y = e.y0;
+    const int dx = std::abs(e.x1-e.x0), dy = -std::abs(e.y1-e.y0);
+    const int sx = e.x0 < e.x1 ? 1 : -1, sy = e.y0 < e.y1 ? 1 : -1;
+    int err = dx+dy;
+    for(;;) {
+      if(x >= 0 && y >= 0 && x < width && y < height) set_cell(x, y, e.alive);
+      if(x == e.x1 && y == e.y1) break;
+      const int e2 = 2*err;
+      if(e2 >= dy) {
+        err += dy;
+        x += sx;
+      }
+      if(e2 <= dx) {
+        err += dx;
+        y += sy;
+      }
+    }
+  }
+  // drop the references to pasted patterns
+  edit_batch.clear();
+  unrecorded = true;
+  if(fixed) fixed->load(cells, last_gen);
+  forget_cycles();
+  cellsEqualGenerations = 0;
+}
+
+void world::set_cell(const int &x, const int &y, const bool &alive) {
+  cells[x][y].alive = alive;
+  if(multi_state()) states.set(x, y, alive ? 1 : 0);
+  dirty_segments[y*segments_per_row + x/segment_width] = 1;
+  mark_dirty_row(y);
+}
+
+// Overwrites the pattern's rectangle at (x0,y0), wrapping around the
+// edges. Large two-state pastes are split by columns over the workers.
+void world::paste(const brush &b, const int &x0, const int &y0) {
+  const int w = std::min(b.width, width), h = std::min(b.height, height);
+  auto columns = [this, &b, x0, y0, h] (const int &from, const int &to) {
+    for(int i = from; i < to; i++) {
+      const int x = ((x0+i) % width + width) % width;
+      cell *col = cells[x].data();
+      for(int j = 0; j < h; j++) {
+        const int y = ((y0+j) % height + height) % height;
+        col[y].alive = b.get(i, j);
+        if(multi_state()) states.set(x, y, col[y].alive ? 1 : 0);
+      }
+    }
+  };
+  if(multi_state() || (size_t)w*h < (size_t)bulk_paste) {
+    columns(0, w);
+  }
+  else {
+    int const workers = (int)pool.workers.size();
+    int const worker_load = (w + workers - 1)/workers;
+    boost::for_each(boost::irange(0, workers), [&] (int worker) {
+        int const from = std::min(w, worker*worker_load), to = std::min(w, from+worker_load);
+        if(from < to) results.emplace_back(run_partition(worker, [&columns, from, to] { columns(from, to); }));
+    });
+    boost::for_each(results, [] (auto &t) { t.wait(); });
+    results.clear();
+  }
+
+  std::vector<char> touched(segments_per_row, 0);
+  for(int i = 0; i < w; i++) touched[(((x0+i) % width + width) % width)/segment_width] = 1;
+  for(int j = 0; j < h; j++) {
+    const int y = ((y0+j) % height + height) % height;
+    for(int s = 0; s < segments_per_row; s++) dirty_segments[y*segments_per_row + s] |= touched[s];
+    mark_dirty_row(y);
+  }
+}
+
+void world::mark_dirty() {
+  std::fill(changed_segments.begin(), changed_segments.end(), 1);
+  std::fill(dirty_segments.begin(), dirty_segments.end(), 1);
+  changed_rows.clear();
+  for(auto y : boost::irange(0, height)) {
+    changed_rows.push_back(y);
+    mark_dirty_row(y);
+  }
+}
+
+// costs the dirty rows of this and the last call, not the board
+bool world::take_dirty_segments(std::vector<char> &segments, std::vector<int> &rows) {
+  sync_cells();
+  if(segments.size() != dirty_segments.size()) {
+    segments.assign(dirty_segments.size(), 0);
+  }
+  else {
+    for(auto y : rows) std::fill_n(&segments[(size_t)y*segments_per_row], segments_per_row, 0);
+  }
+  std::sort(dirty_rows.begin(), dirty_rows.end());
+  rows.swap(dirty_rows);
+  dirty_rows.clear();
+  for(auto y : rows) {
+    char *dirty = &dirty_segments[(size_t)y*segments_per_row];
+    std::copy(dirty, dirty+segments_per_row, &segments[(size_t)y*segments_per_row]);
+    std::fill_n(dirty, segments_per_row, 0);
+    row_listed[y] = 0;
+  }
+  return !rows.empty();
+}
+
+// Only the columns and rows of live[0] can hold live cells. The columns
+// are split evenly over the workers.
+void world::pack_board(std::vector<uint64_t> &words) {
+  // a fixed board packs from its row words, leaving the cells stale
+  if(fixed) {
+    fixed->pack(words);
+    return;
+  }
+  sync_cells();
+  if(multi_state()) {
+    words = states.bits;
+    return;
+  }
+  const int column_words = (height+63)/64;
+  words.assign((size_t)width*column_words, 0);
+  std::vector< std::pair<int,int> > pieces, rows;
+  crop::pieces(live[0].x, width, pieces);
+  crop::pieces(live[0].y, height, rows);
+  std::vector<int> columns;
+  for(auto const &c : pieces) {
+    for(int x = c.first; x < c.second; x++) columns.push_back(x);
+  }
+
+  int const workers = (int)pool.workers.size();
+  boost::for_each(boost::irange(0, workers), [&] (int worker) {
+      const size_t from = columns.size()*worker/workers, to = columns.size()*(worker+1)/workers;
+      if(from >= to) return;
+      results.emplace_back(run_partition(worker, [this, &words, &columns, &rows, column_words, from, to] {
+        for(size_t i = from; i < to; i++) {
+          const int x = columns[i];
+          const cell *col = cells[x].data();
+          uint64_t *out = &words[(size_t)x*column_words];
+          for(auto const &r : rows) {
+            int y = r.first;
+            for(; y < r.second && y%8; y++) out[y/64] |= (uint64_t)col[y].alive << (y%64);
+            for(; y+8 <= r.second; y += 8) {
+              uint64_t bytes;
+              std::memcpy(&bytes, col+y, 8);
+              out[y/64] |= bitrow::pack_bytes(bytes) << (y%64);
+            }
+            for(; y < r.second; y++) out[y/64] |= (uint64_t)col[y].alive << (y%64);
+          }
         }
+      }));
+  });
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+}
+
+void world::unpack_board(const std::vector<uint64_t> &words) {
+  if(multi_state()) {
+    states.bits = words;
+    last_states = states;
+    last_last_states = states;
+    forget_cycles();
+  }
+  else {
+    const int column_words = (height+63)/64;
+    int const workers = (int)pool.workers.size();
+    boost::for_each(boost::irange(0, workers), [&] (int worker) {
+        const int from = width*worker/workers, to = width*(worker+1)/workers;
+        if(from >= to) return;
+        results.emplace_back(run_partition(worker, [this, &words, column_words, from, to] {
+          for(int x = from; x < to; x++) {
+            const uint64_t *in = &words[(size_t)x*column_words];
+            cell *col = cells[x].data();
+            int y = 0;
+            for(; y+8 <= height; y += 8) {
+              const uint64_t bytes = bitrow::unpack_bytes(in[y/64] >> (y%64));
+              std::memcpy(col+y, &bytes, 8);
+            }
+            for(; y < height; y++) col[y].alive = (in[y/64] >> (y%64)) & 1;
+          }
+        }));
+    });
+    boost::for_each(results, [] (auto &t) { t.wait(); });
+    results.clear();
+    last_gen = cells;
+    import_cells();
+  }
+  unrecorded = false;
+  cellsEqualGenerations = 0;
+  lastGenEqual = false;
+  mark_dirty();
+}
+
+void world::remember() {
+  if(!rewind.enabled()) return;
+  pack_board(packed);
+  rewind.record(generation, packed);
+  unrecorded = false;
+}
+
+// Back to the generation before the last recorded one. Edits since then
+// are recorded first, so the first step back only undoes them.
+bool world::step_back() {
+  if(!rewind.enabled()) return false;
+  apply_edits();
+  if(unrecorded) remember();
+  int g;
+  if(!rewind.back(packed, g)) return false;
+  unpack_board(packed);
+  generation = g;
+  return true;
+}
+
+// one byte per cell in column order, the .gol dump format
+void world::snapshot(std::vector<char> &bytes) {
+  sync_cells();
+  bytes.resize((size_t)width*height);
+  if(multi_state()) {
+    for(auto x : boost::irange(0, width)) {
+      for(auto y : boost::irange(0, height)) {
+        bytes[(size_t)x*height + y] = (char)cell_state(x, y);
       }
     }
+    return;
   }
+  static_assert(sizeof(cell) == 1, "cells are dumped as bytes");
+  for(auto x : boost::irange(0, width)) {
+    std::memcpy(&bytes[(size_t)x*height], cells[x].data(), height);
+  }
+}
+
+void world::checkpoint() {
+  auto bytes = checkpoints.take_buffer();
+  snapshot(bytes);
+  append_generation(bytes, generation);
+  checkpoints.submit(std::move(bytes),
+      checkpoint_dir+"/checkpoint_"+std::to_string(generation)+".gol", true);
+}
+
+void world::dump_generation() {
+  last_dump = get_timestamp();
+  random_gen r(1000000,9999999);
+  last_dump_str = std::to_string(r.get())+"_"+std::to_string(last_dump);
+  auto bytes = checkpoints.take_buffer();
+  snapshot(bytes);
+  append_generation(bytes, generation);
+  checkpoints.submit(std::move(bytes), "dump_"+last_dump_str+".gol", false);
+}
+
+// Either loader throws before touching the board when the file does not
+// fit it.
+void world::load_generation(std::string filename, bool isBinary) {
+  // the file may be a dump that is still being written
+  checkpoints.wait_idle();
+  const mapped_file file(filename);
+  if(isBinary) load_binary(file, filename);
+  else load_text(file, filename);
   last_gen = cells;
+  import_cells();
+  mark_dirty();
 }
 
-unsigned long world::get_timestamp() {
-  return
-      std::chrono::system_clock::now().time_since_epoch() /
-      std::chrono::milliseconds(1);
+// one byte per cell in column order as written by snapshot, any byte but
+// 0 alive; the generation comes from the trailer of checkpoints and dumps
+void world::load_binary(const mapped_file &file, const std::string &filename) {
+  const size_t needed = (size_t)width*height;
+  uint64_t saved_generation = 0;
+  const bool trailer = read_generation(file.data, file.size, needed, saved_generation);
+  if(file.size != needed && !trailer) {
+    throw std::runtime_error(filename + " holds " + std::to_string(file.size) + " bytes, a " +
+                             std::to_string(width) + "x" + std::to_string(height) + " board needs " +
+                             std::to_string(needed));
+  }
+  int const workers = (int)pool.workers.size();
+  for(auto worker : boost::irange(0, workers)) {
+    const int from = width*worker/workers, to = width*(worker+1)/workers;
+    if(from >= to) continue;
+    results.emplace_back(pool.enqueue([this, &file, from, to] {
+      for(int x = from; x < to; x++) {
+        const char *in = file.data + (size_t)x*height;
+        cell *col = cells[x].data();
+        for(int y = 0; y < height; y++) col[y].alive = in[y] != 0;
+      }
+    }));
+  }
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+  if(trailer) generation = (int)saved_generation;
 }
 
-int const world::count_neighbours(const std::array<int,2> &ni, const int &x, const int &y) {
-  int x_off = ni[0];
-  int y_off = ni[1];
-  int nx = x+x_off;
-  int ny = y+y_off;
+namespace {
+  bool line_break(const char &c) { return c == '\n' || c == '\r'; }
 
-  if(nx == width) {
-    nx = 0;
-    //return 0;
+  // the first '\n' or '\r' in [from, to), else to
+  const char *find_break(const char *from, const char *to) {
+    auto const n = (const char*)std::memchr(from, '\n', to-from);
+    if(n) to = n;
+    auto const r = (const char*)std::memchr(from, '\r', to-from);
+    return r ? r : to;
   }
-  if(nx == -1) {
-    nx = width-1;
-    //return 0;
+}
+
+// Row-major text, '0' for a live cell and any other printable character
+// for a dead one. Line breaks are skipped wherever they are, so rows are
+// simply the next width cells. Three passes over the mapped file: the
+// workers count the line breaks in their part of the file, which gives
+// the cell every part starts with; then they note where each row starts;
+// then every worker turns bands of 64 rows into columns.
+void world::load_text(const mapped_file &file, const std::string &filename) {
+  int const workers = (int)pool.workers.size();
+  auto const part_from = [&file, workers] (const int &part) { return file.size*part/workers; };
+  std::vector<size_t> breaks(workers, 0), controls(workers, 0);
+  for(auto worker : boost::irange(0, workers)) {
+    results.emplace_back(pool.enqueue([&, worker] {
+      // byte sized counters over short blocks, so the loop vectorizes
+      size_t n = 0, bad = 0;
+      const size_t to = part_from(worker+1);
+      for(size_t i = part_from(worker); i < to; i += 255) {
+        const unsigned char *block = (const unsigned char*)file.data + i;
+        const size_t m = std::min<size_t>(255, to - i);
+        unsigned char block_breaks = 0, block_bad = 0;
+        for(size_t k = 0; k < m; k++) {
+          const unsigned char brk = (block[k] == '\n') | (block[k] == '\r');
+          block_breaks += brk;
+          block_bad |= (block[k] < 0x20) & !brk;
+        }
+        n += block_breaks;
+        bad += block_bad;
+      }
+      breaks[worker] = n;
+      controls[worker] = bad;
+    }));
   }
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
 
-  if(ny == height) {
-    ny = 0;
-    //return 0;
+  for(auto worker : boost::irange(0, workers)) {
+    if(!controls[worker]) continue;
+    size_t i = part_from(worker);
+    while((unsigned char)file.data[i] >= 0x20 || line_break(file.data[i])) i++;
+    throw std::runtime_error(filename + " is not a text pattern, byte " + std::to_string(i) +
+                             " is control character " + std::to_string((int)(unsigned char)file.data[i]));
   }
-  if(ny == -1) {
-    ny = height-1;
-    //return 0;
+  size_t total = 0;
+  for(auto n : breaks) total += n;
+  const size_t needed = (size_t)width*height;
+  if(file.size - total != needed) {
+    throw std::runtime_error(filename + " holds " + std::to_string(file.size - total) + " cells, a " +
+                             std::to_string(width) + "x" + std::to_string(height) + " board needs " +
+                             std::to_string(needed));
   }
 
-  if(last_gen[nx][ny].alive) {
-    return 1;
+  // rows cut by a line break are gathered into one piece before use
+  std::vector<size_t> row_start(height);
+  std::vector< std::vector<int> > cut_rows(workers);
+  size_t first_cell = 0;
+  for(auto worker : boost::irange(0, workers)) {
+    const size_t from = part_from(worker), to = part_from(worker+1);
+    results.emplace_back(pool.enqueue([&, worker, first_cell, from, to] {
+      size_t k = first_cell;
+      const char *p = file.data + from, *end = file.data + to;
+      while(p < end) {
+        if(line_break(*p)) {
+          // a break inside a row, also one the part starts with
+          if(k % width != 0) cut_rows[worker].push_back((int)(k/width));
+          p++;
+          continue;
+        }
+        const size_t x = k % width;
+        if(x == 0) row_start[k/width] = p - file.data;
+        const char *run_end = p + std::min<size_t>(width - x, end - p);
+        const char *stop = find_break(p, run_end);
+        k += stop - p;
+        if(stop != run_end) cut_rows[worker].push_back((int)(k/width));
+        p = stop;
+      }
+    }));
+    first_cell += (to - from) - breaks[worker];
+  }
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
+  std::vector<char> cut(height, 0);
+  for(auto const &rows : cut_rows) {
+    for(auto y : rows) cut[y] = 1;
   }
 
-  return 0;
+  const int band = 64;
+  const int bands = (height + band-1)/band;
+  for(auto worker : boost::irange(0, workers)) {
+    const int from = bands*worker/workers, to = bands*(worker+1)/workers;
+    if(from >= to) continue;
+    results.emplace_back(pool.enqueue([&, from, to] {
+      std::vector<char> gathered;
+      const char *rows[band];
+      for(int b = from; b < to; b++) {
+        const int y0 = b*band, n = std::min(band, height - y0);
+        for(int j = 0; j < n; j++) {
+          const char *p = file.data + row_start[y0+j];
+          if(!cut[y0+j]) {
+            rows[j] = p;
+            continue;
+          }
+          gathered.resize((size_t)band*width);
+          char *out = &gathered[(size_t)j*width];
+          for(int x = 0; x < width; p++) {
+            if(!line_break(*p)) out[x++] = *p;
+          }
+          rows[j] = out;
+        }
+        // 8x8 tiles: eight rows of eight characters become a bit
+        // matrix, transposed into eight columns
+        int x = 0;
+        for(; x+8 <= width; x += 8) {
+          int j = 0;
+          for(; j+8 <= n; j += 8) {
+            uint64_t tile = 0;
+            for(int r = 0; r < 8; r++) {
+              uint64_t chars;
+              std::memcpy(&chars, rows[j+r]+x, 8);
+              tile |= bitrow::pack_bytes(bitrow::bytes_equal(chars, '0')) << (8*r);
+            }
+            tile = bitrow::transpose8(tile);
+            for(int c = 0; c < 8; c++) {
+              const uint64_t alive = bitrow::unpack_bytes(tile >> (8*c));
+              std::memcpy(cells[x+c].data() + y0+j, &alive, 8);
+            }
+          }
+          for(; j < n; j++) {
+            for(int c = 0; c < 8; c++) cells[x+c][y0+j].alive = rows[j][x+c] == '0';
+          }
+        }
+        for(; x < width; x++) {
+          cell *col = cells[x].data() + y0;
+          for(int j = 0; j < n; j++) col[j].alive = rows[j][x] == '0';
+        }
+      }
+    }));
+  }
+  boost::for_each(results, [] (auto &t) { t.wait(); });
+  results.clear();
 }
 
-const int world::neighbours(const int &x, const int &y) {
-  const std::array<std::array<int,2>, 8> n_arr{{
-    {-1, 1}, {0, 1}, {1, 1},
-    {-1, 0},         {1, 0},
-    {-1,-1}, {0,-1}, {1,-1}
-  }};
-
-  auto sum = [=](auto a, auto b) { return a + count_neighbours(b, x, y); };
-  return std::accumulate(n_arr.begin(), n_arr.end(), 0, sum);
+unsigned long world::get_timestamp() {
+  return
+      std::chrono::system_clock::now().time_since_epoch() /
+      std::chrono::milliseconds(1);
 }
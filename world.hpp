@@ -3,8 +3,20 @@
 
 #include <vector>
 #include <array>
+#include <deque>
+#include <unordered_map>
+#include <string>
 
 #include "ThreadPool.h"
+#include "rule.hpp"
+#include "generations.hpp"
+#include "checkpoint.hpp"
+#include "fixed_world.hpp"
+#include "balance.hpp"
+#include "edit_queue.hpp"
+#include "crop.hpp"
+#include "history.hpp"
+#include "mapped_file.hpp"
 
 struct cell {
   bool alive;
@@ -26,23 +38,206 @@ public:
   int ratio_w;
   int ratio_h;
   int generation;
+  // random boards are numbered from seed, reseeds counting up from 0
+  uint64_t seed;
+  int density;
+  uint64_t reseeds;
   unsigned long last_dump;
   std::string last_dump_str;
   ThreadPool pool;
   std::vector< std::future<void> > results;
+  // change tracking in segments of segment_width cells of one row;
+  // segments shared by two workers go through edge_flags, so the kernels
+  // flag them without locks
+  static const int segment_width = 64;
+  int segments_per_row;
+  std::vector<char> changed_segments;
+  std::vector<char> last_changed_segments;
+  // the rows with a flag in changed_segments and last_changed_segments, so
+  // clearing and merging them costs the rows a step touched
+  std::vector<int> changed_rows;
+  std::vector<int> last_changed_rows;
+  // segments whose rendering may differ since the last take_dirty_segments(),
+  // and their rows, each listed once as row_listed says
+  std::vector<char> dirty_segments;
+  std::vector<int> dirty_rows;
+  std::vector<char> row_listed;
+  // one part per worker, in columns for the two-state kernels and in rows
+  // for multi-state rules; see set_partitioning
+  balancer column_parts;
+  balancer row_parts;
+  rule life_rule;
+  // next state indexed by alive*9 + neighbours, for rules without a kernel
+  std::array<char, 18> rule_table;
+  // "torus", "dead", "cylinder" (wraps left to right only) or "klein"
+  // (wraps left to right, and top to bottom mirrored); see set_boundary
+  std::string boundary;
+  // last_gen with a border of ghost cells holding whatever the boundary
+  // puts next to the edge, column-major with padded_height cells per
+  // column; one more zero column and row keep the block kernel in bounds
+  // on odd sizes. It costs a second board's worth of memory, but each step
+  // only refills the pieces of the crop it steps plus their ghost cells.
+  std::vector<cell> padded;
+  int padded_height;
+  // every live cell of cells, last_gen and last_last_gen lies in live[0],
+  // live[1] and live[2]; a generation only steps live[0] grown by one
+  // cell, in the row ranges step_rows. Rules with B0 light up empty
+  // space, so they always step the whole board.
+  crop_box live[3];
+  std::vector< std::pair<int,int> > step_rows;
+  std::vector<char> live_columns;
+  // rows with live cells, one vector per worker
+  std::vector< std::vector<char> > live_rows;
+  // segments a worker shares with another one this step, and a column of
+  // flags of height rows for each
+  std::vector< std::vector<char> > edge_flags;
+  std::vector< std::vector<int> > edge_segments;
+  struct column_run {
+    int from_x;
+    int to_x;
+    char *changed;
+    int stride;
+  };
+  // Steps columns from_x to to_x and flags a changed cell of row y in
+  // changed[y*stride], the segment of from_x; later segments of the range
+  // follow at changed+1 and so on.
+  typedef void (world::*step_fn)(const int &from_x, const int &to_x, char *changed, const int &stride);
+  step_fn step_columns;
+  // "auto", "table" or "block", see set_kernel
+  std::string kernel;
+  // next state of a 2x2 block indexed by its 4x4 neighbourhood, bit
+  // 4*row+column of the index; output bit 2*row+column
+  std::vector<unsigned char> block_table;
+  // compile-time sized board that steps instead of the grid when the size
+  // matches; cells then only catch up in sync_cells()
+  std::unique_ptr<fixed_board> fixed;
+  bool cells_stale;
+  // with a target, cycles are skipped to land on it directly
+  int target_generation;
+  static const int cycle_window = 4096;
+  std::unordered_map<uint64_t, int> seen_states;
+  std::deque<uint64_t> seen_order;
+  // the last cycle found, jumped_from is -1 before any was skipped
+  int cycle_period;
+  int cycle_start;
+  // generation at which the board is compared with cycle_board, -1 for
+  // none; see skip_cycle
+  int cycle_check;
+  std::vector<uint64_t> cycle_board;
+  std::vector<uint64_t> cycle_next;
+  int jumped_from;
+  // bit-plane storage used instead of cells for rules with more than two states
+  state_planes states;
+  state_planes last_states;
+  state_planes last_last_states;
+  // snapshots are written in the background every checkpoint_every generations
+  checkpoint_writer checkpoints;
+  int checkpoint_every;
+  std::string checkpoint_dir;
+  // node of the cpu each worker is pinned to, empty when not pinned
+  std::vector<int> worker_nodes;
+  // keep every partition on the pages of the worker that steps it
+  bool numa_placement;
+  bool huge_pages;
+  // painting and pastes from the UI, applied between generations
+  edit_queue edits;
+  std::vector<edit> edit_batch;
+  // pastes of at least this many cells are written by the workers
+  static const int bulk_paste = 1 << 16;
+  // past generations for step_back, empty unless given a budget
+  history rewind;
+  std::vector<uint64_t> packed;
+  // the board changed since it was last recorded, other than by stepping
+  bool unrecorded;
 
 public:
   world(const int &width = 100, const int &height = 70, const int &threads = 1);
 
+  void set_seed(const uint64_t &seed, const int &percent);
   void seed_life(const bool random = true);
   void seed_life(cell_grid &seed);
+  void column_range(const int &worker, int &from_x, int &to_x) const;
+  void row_range(const int &worker, int &from_y, int &to_y) const;
+  // Stepping comes before anything else queued on the pool, pinned or
+  // not. Partitions stick to their worker once workers are pinned,
+  // otherwise any idle worker takes them.
+  template<class F>
+  std::future<void> run_partition(const int &worker, F &&f) {
+    if(worker_nodes.empty()) return pool.enqueue_at(ThreadPool::high, std::forward<F>(f));
+    return pool.enqueue_to_at(worker, ThreadPool::high, std::forward<F>(f));
+  }
+  void pin_workers();
+  void place_partitions();
+  void advise_huge_pages();
+  std::string numa_report();
   void next_generation();
-  void evolution(const int &x, const int &y);
+  void advance();
+  void skip_cycle();
+  void forget_cycles();
+  uint64_t state_hash();
+  void step_cells();
+  void step_fixed();
+  void sync_cells();
+  void step_states();
+  bool same_as_two_generations_ago();
+  void set_rule(const rule &r);
+  void set_kernel(const std::string &name);
+  void set_partitioning(const std::string &name);
+  void set_boundary(const std::string &name);
+  void fill_halo(const int &from_x, const int &to_x, const int &from_y, const int &to_y);
+  // after the cells changed behind the kernels' back
+  void uncrop();
+  void add_live(const int &x, const int &y, const int &w, const int &h);
+  // cell (x, 0) of the padded last generation
+  const cell *halo_column(const int &x) const { return &padded[(size_t)(x+1)*padded_height + 1]; }
+  // live cells around c, which points into padded
+  int neighbours(const cell *c) const {
+    const int h = padded_height;
+    return c[-h-1].alive + c[-h].alive + c[-h+1].alive +
+           c[-1].alive + c[1].alive +
+           c[h-1].alive + c[h].alive + c[h+1].alive;
+  }
+  void choose_kernel();
+  bool multi_state() const { return life_rule.states > 2; }
+  int cell_state(const int &x, const int &y) const;
+  void import_cells();
+  template<unsigned Birth, unsigned Survive>
+  void step_rule(const int &from_x, const int &to_x, char *changed, const int &stride);
+  void step_table(const int &from_x, const int &to_x, char *changed, const int &stride);
+  void step_blocks(const int &from_x, const int &to_x, char *changed, const int &stride);
+  template<unsigned Birth, unsigned Survive>
+  bool evolution(cell &c, const int &n);
+  bool evolution_table(cell &c, const int &n);
+  void mark_dirty();
+  void mark_dirty_row(const int &y) {
+    if(row_listed[y]) return;
+    row_listed[y] = 1;
+    dirty_rows.push_back(y);
+  }
+  void note_changed_rows(const int &from_y, const int &to_y);
+  void apply_edits();
+  void set_cell(const int &x, const int &y, const bool &alive);
+  void paste(const brush &b, const int &x0, const int &y0);
+  // Moves the dirty flags into segments, a flag per segment of the board,
+  // and the rows that have any into rows, ascending. rows must still hold
+  // what the last call gave back, those rows of segments are cleared first.
+  bool take_dirty_segments(std::vector<char> &segments, std::vector<int> &rows);
+  // the board as words for rewind: the state planes of a multi-state
+  // rule, else a bit per cell, column-major with (height+63)/64 words per
+  // column
+  void pack_board(std::vector<uint64_t> &words);
+  void unpack_board(const std::vector<uint64_t> &words);
+  void remember();
+  bool step_back();
+  void snapshot(std::vector<char> &bytes);
+  void checkpoint();
   void dump_generation();
+  // throws std::runtime_error on files that can't be read or don't fit
+  // the board, which then stays as it was
   void load_generation(std::string filename, bool isBinary = true);
+  void load_binary(const mapped_file &file, const std::string &filename);
+  void load_text(const mapped_file &file, const std::string &filename);
   unsigned long get_timestamp();
-  int const neighbours(const int &x, const int &y);
-  int const count_neighbours(const std::array<int,2> &ni, const int &x, const int &y);
 };
 
 #endif // WORLD_HPP